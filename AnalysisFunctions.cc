@@ -34,7 +34,7 @@ template<class T>std::vector<T *>                                  SelectorFcn(s
 // Computations of fundamental quantities, like Bjorken x, etc.
 
 
-inline std::map<std::string, float>DISVariables(TClonesArray *branchParticle)
+inline std::map<std::string, float>DISVariables(TObjArray *branchParticle)
 {
   // four-momenta of proton, electron, virtual photon/Z^0/W^+-.
   auto pProton = static_cast<GenParticle *>(branchParticle->At(0))->P4(); // these
@@ -68,10 +68,10 @@ inline std::map<std::string, float>DISVariables(TClonesArray *branchParticle)
   return dis_variables;
 }
 
-inline std::map<std::string, float>DISJacquetBlondel(TClonesArray *tracks,
-                                                     TClonesArray *electrons,
-                                                     TClonesArray *photons,
-                                                     TClonesArray *neutral_hadrons)
+inline std::map<std::string, float>DISJacquetBlondel(TObjArray *tracks,
+                                                     TObjArray *electrons,
+                                                     TObjArray *photons,
+                                                     TObjArray *neutral_hadrons)
 {
   // Jacquet-Blondel method:
   float delta_track = 0.0;
@@ -147,19 +147,16 @@ inline std::map<std::string, float>DISJacquetBlondel(TClonesArray *tracks,
 // Jet Functions
 //
 
-inline Double_t JetCharge(Jet *jet, TClonesArray *tracks, Double_t kappa = 0.5)
+// Charge of the jet from the tracks associated with it
+inline Double_t JetCharge(Jet *jet, const std::vector<Track *>& tracks, Double_t kappa = 0.5)
 {
   Double_t jet_Q = -99.0;
 
-  for (auto obj_track : *tracks) {
-    auto track = static_cast<Track *>(obj_track);
-
-    if (track->P4().DeltaR(jet->P4()) < 0.5) {
-      if (jet_Q == -99.0) {
-        jet_Q = 0.0;
-      }
-      jet_Q += track->Charge * TMath::Power(track->PT, kappa);
+  for (auto track : tracks) {
+    if (jet_Q == -99.0) {
+      jet_Q = 0.0;
     }
+    jet_Q += track->Charge * TMath::Power(track->PT, kappa);
   }
   jet_Q /= TMath::Power(jet->PT, kappa);
 
@@ -322,57 +319,31 @@ inline bool Tagged_Muon(Jet *jet, std::vector<Track *>muons, float minSignif, fl
   return tagged;
 }
 
-inline bool Tagged_sIP3D(Jet *jet, TClonesArray tracks,
+// Tagged if at least minTracks of the tracks associated with the jet are
+// displaced by more than minSignif
+inline bool Tagged_sIP3D(Jet *jet, const std::vector<Track *>& tracks,
                          float minSignif, float minPT, int minTracks,
                          GenParticle *BeamSpot = nullptr)
 {
   bool tagged = false;
 
-  const TLorentzVector& jetMomentum = jet->P4();
-  float jpx                         = jetMomentum.Px();
-  float jpy                         = jetMomentum.Py();
-  float jpz                         = jetMomentum.Pz();
-
-  auto jet_constituents = tracks;
-
   int N_sIPtrack = 0;
 
-  // std::cout << "------------ Processing Jet " << jet << " ------------" <<
-  // std::endl;
-
-  for (int iconst = 0; iconst < jet_constituents.GetEntries(); iconst++) {
+  for (auto track : tracks) {
     if (N_sIPtrack >= minTracks) break;
 
-    auto constituent = jet_constituents.At(iconst);
+    if (track->PT < minPT) continue;
 
-    if (constituent == 0) continue;
+    // Avoid decays that are too far from the beamspot (e.g. Ks, etc.)
+    if (!IsTaggingTrack(track)) continue;
 
-    if (constituent->IsA() == Track::Class()) {
-      auto track = static_cast<Track *>(constituent);
+    float sip = sIP3D(jet, track, BeamSpot);
 
-      const TLorentzVector& trkMomentum = track->P4();
-      float tpt                         = trkMomentum.Pt();
-
-      if (tpt < minPT) continue;
-
-      if (trkMomentum.DeltaR(jetMomentum) > 0.5) continue;
-
-      // Avoid decays that are too far from the beamspot (e.g. Ks, etc.)
-      // float d0 = TMath::Abs(track->D0);
-      // float z0 = TMath::Abs(track->DZ);
-      if (!IsTaggingTrack(track)) continue;
-
-      float sip = sIP3D(jet, track, BeamSpot);
-
-
-      if (sip > minSignif) N_sIPtrack++;
-    }
+    if (sip > minSignif) N_sIPtrack++;
   }
 
   tagged = (N_sIPtrack >= minTracks);
 
-  // std::cout << "------------ xxxxxxxxxxxxxx ------------" << std::endl;
-
   return tagged;
 }
 
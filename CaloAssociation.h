@@ -0,0 +1,107 @@
+#ifndef CALOASSOCIATION_HH
+#define CALOASSOCIATION_HH
+
+/**
+   Association of generated particles to the calorimeter towers they
+   deposited energy in, built by inverting Tower::Particles once per event
+   on the first request and shared by every module that needs it. Tracks
+   (and electrons) are matched to towers through their Particle reference.
+
+   Modules get the shared instance for a tower list in their initialize()
+   with CaloAssociation::get(store, towerList, requester); it is kept in the
+   DataStore under "CaloAssociation:<towerList>".
+ **/
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "TObject.h"
+#include "TObjArray.h"
+
+#include "classes/DelphesClasses.h"
+#include "DataStore.h"
+
+class CaloAssociation {
+  friend class DataStore;
+
+public:
+
+  // Towers of one particle and their summed energies
+  struct Deposit {
+    Double_t Eem  = 0.0;
+    Double_t Ehad = 0.0;
+    std::vector<Tower *> towers;
+  };
+
+  static CaloAssociation* get(DataStore *store, std::string towerList, std::string requester = "") {
+    std::string name = "CaloAssociation:" + towerList;
+
+    return store->shared<CaloAssociation>(name, requester, [&]() { return new CaloAssociation(store, towerList, requester); });
+  }
+
+  // Deposit of a particle, or nullptr if it has no tower (or is nullptr)
+  const Deposit* find(TObject *particle) {
+    if (particle == nullptr) return nullptr;
+
+    if (!_built) build();
+
+    auto deposit = _deposits.find(particle);
+
+    return (deposit != _deposits.end()) ? &(deposit->second) : nullptr;
+  }
+
+  Double_t Eem(TObject *particle) {
+    const Deposit *deposit = find(particle);
+
+    return (deposit != nullptr) ? deposit->Eem : 0.0;
+  }
+
+  Double_t Ehad(TObject *particle) {
+    const Deposit *deposit = find(particle);
+
+    return (deposit != nullptr) ? deposit->Ehad : 0.0;
+  }
+
+private:
+
+  CaloAssociation(DataStore *store, std::string towerList, std::string requester) {
+    _store       = store;
+    _tower_input = store->find<TObjArray>(towerList, requester, { "Eem", "Ehad", "Particles" });
+
+    // Tower::Particles points into the generated particles
+    store->find<TObjArray>("Particle", requester, { "PID" });
+  }
+
+  void build() {
+    TObjArray *towers = _store->get(_tower_input);
+
+    for (Int_t t = 0; t < towers->GetEntries(); t++) {
+      auto calotower = static_cast<Tower *>(towers->At(t));
+
+      for (Int_t ref = 0; ref < calotower->Particles.GetEntries(); ref++) {
+        TObject *particle = calotower->Particles.At(ref);
+
+        if (particle == nullptr) continue;
+
+        Deposit& deposit = _deposits[particle];
+        deposit.Eem  += calotower->Eem;
+        deposit.Ehad += calotower->Ehad;
+        deposit.towers.push_back(calotower);
+      }
+    }
+    _built = true;
+  }
+
+  void reset() {
+    _deposits.clear();
+    _built = false;
+  }
+
+  DataStore *_store = nullptr;
+  DataStore::Handle<TObjArray>_tower_input;
+  std::unordered_map<TObject *, Deposit>_deposits;
+  Bool_t _built = false;
+};
+
+#endif // ifndef CALOASSOCIATION_HH
@@ -7,7 +7,10 @@
 #include "TObjString.h"
 #include "TH1.h"
 #include "TFile.h"
-#include "TRandom.h"
+#include "TMath.h"
+
+#include <algorithm>
+#include <cstdint>
 
 #include "TreeHandler.h"
 
@@ -15,8 +18,7 @@ CaloEnergyCorrectorModule::CaloEnergyCorrectorModule(ExRootTreeReader *data, std
   : Module(data, name)
 {
   _params        = std::map<std::string, std::string>();
-  _EMFractionMap = new std::map<TObject*, Double_t>();
-  _emfrac_file   = TFile::Open("share/EMRatioPDFs.root");
+  _EMFractionMap = new EMFractionMap();
 }
 
 CaloEnergyCorrectorModule::~CaloEnergyCorrectorModule()
@@ -46,68 +48,132 @@ void CaloEnergyCorrectorModule::initialize()
       std::cout << getName() << "::" << r << ": value set to " << _params[r] << std::endl;
     }
   }
-}
 
-void CaloEnergyCorrectorModule::finalize()
-{}
+  // Resolve the input lists and register the output map. The generated
+  // particles are needed to resolve the track and tower references.
+  DataStore *store = getDataStore();
 
-bool CaloEnergyCorrectorModule::execute(std::map<std::string, std::any> *DataStore)
-{
-  auto data = getData();
+  _inputTrackHandle = store->find<TObjArray>(_params["inputTrackList"], getName() + "::CaloEnergyCorrectorModule",
+                                             { "Eta", "Particle" });
+  _calo             = CaloAssociation::get(store, _params["inputTowerList"], getName() + "::CaloEnergyCorrectorModule");
+  store->find<TObjArray>("Particle", getName() + "::CaloEnergyCorrectorModule", { "PID" });
+  _outputHandle     = store->book<EMFractionMap>(_params["outputEMFractionMap"], getName() + "::CaloEnergyCorrectorModule");
+  store->put(_outputHandle, _EMFractionMap);
 
-  TObjArray *inputTrackList = nullptr;
-  TObjArray *inputTowerList = nullptr;
-
-  // search in the DataStore for this list
-  if (DataStore->find(_params["inputTrackList"]) != DataStore->end()) {
-    try {
-      inputTrackList = std::any_cast<TObjArray *>((*DataStore)[_params["inputTrackList"]]);
-    } catch (const std::bad_any_cast& e)
-    {
-      try {
-        inputTrackList = std::any_cast<TClonesArray *>((*DataStore)[_params["inputTrackList"]]);
-      } catch (const std::bad_any_cast& e)
-      {
-        std::stringstream message;
-        message << "Input list " << _params["inputTrackList"] << " must be either TObjArray or TClonesArray! [" << getName() << "::CaloEnergyCorrectorModule]" << std::endl;
-        throw std::runtime_error(message.str());
-      }
-    }
-  } else {
+  // Tabulate the Full-Sim-based PDFs for calo. energy fractions
+  TFile *emfrac_file = TFile::Open("share/EMRatioPDFs.root");
+
+  if (emfrac_file == nullptr || emfrac_file->IsZombie()) {
     std::stringstream message;
-    message << "Unable to locate " << _params["inputTrackList"] << " specified in module " << getName() << " of class CaloEnergyCorrectorModule!" << std::endl;
+    message << "Unable to open share/EMRatioPDFs.root! [" << getName() << "::CaloEnergyCorrectorModule]" << std::endl;
     throw std::runtime_error(message.str());
   }
 
-  // search in the DataStore for this list
-  if (DataStore->find(_params["inputTowerList"]) != DataStore->end()) {
-    try {
-      inputTowerList = std::any_cast<TObjArray *>((*DataStore)[_params["inputTowerList"]]);
-    } catch (const std::bad_any_cast& e)
-    {
-      try {
-        inputTowerList = std::any_cast<TClonesArray *>((*DataStore)[_params["inputTowerList"]]);
-      } catch (const std::bad_any_cast& e)
-      {
+  const char *regions[3] = { "Backward", "Barrel", "Forward" };
+  const Int_t species[2] = { 11, 211 };
+
+  for (Int_t r = 0; r < 3; r++) {
+    for (Int_t s = 0; s < 2; s++) {
+      TString PDFname = Form("EMEnergyRatios_%s_%d_pdf", regions[r], species[s]);
+      TH1    *pdf     = static_cast<TH1 *>(emfrac_file->Get(PDFname.Data()));
+
+      if (pdf == nullptr) {
         std::stringstream message;
-        message << "Input list " << _params["inputTowerList"] << " must be either TObjArray or TClonesArray! [" << getName() << "::CaloEnergyCorrectorModule]" << std::endl;
+        message << "EM Ratio PDF " << PDFname.Data()
+                << " was not loaded correctly! [" << getName() << "::CaloEnergyCorrectorModule]" << std::endl;
+        throw std::runtime_error(message.str());
+      }
+
+      _emfrac_cdf[r][s].fill(pdf);
+
+      if (_emfrac_cdf[r][s].cumulative.back() <= 0.0) {
+        std::stringstream message;
+        message << "EM Ratio PDF " << PDFname.Data()
+                << " has no entries in [0, 1]! [" << getName() << "::CaloEnergyCorrectorModule]" << std::endl;
         throw std::runtime_error(message.str());
       }
     }
-  } else {
-    std::stringstream message;
-    message << "Unable to locate " << _params["inputTowerList"] << " specified in module " << getName() << " of class CaloEnergyCorrectorModule!" << std::endl;
-    throw std::runtime_error(message.str());
   }
 
-  // Write a new list of refined candidates to the outputTowerList
-  if (DataStore->find(_params["outputEMFractionMap"]) != DataStore->end()) {
-    // Do not allow overwrites of existing contents in the DataStore
-    std::stringstream message;
-    message << "An object named " << _params["outputEMFractionMap"] << " already exists in the DataStore! [" << getName() << "::CaloEnergyCorrectorModule]" << std::endl;
-    throw std::runtime_error(message.str());
+  emfrac_file->Close();
+  delete emfrac_file;
+}
+
+void CaloEnergyCorrectorModule::InverseCDF::fill(TH1 *pdf)
+{
+  // The EM fraction used to be drawn by accept-reject: x uniform in [0, 1],
+  // accepted with probability proportional to the content of the bin
+  // containing x. The density is therefore the bin content over the part of
+  // each bin (including under- and overflow) inside [0, 1].
+  TAxis *axis = pdf->GetXaxis();
+  Int_t  nbins = axis->GetNbins();
+
+  edges.assign(1, 0.0);
+  cumulative.clear();
+
+  for (Int_t bin = 0; bin <= nbins + 1; bin++) {
+    Double_t low  = (bin == 0) ? 0.0 : axis->GetBinLowEdge(bin);
+    Double_t high = (bin == nbins + 1) ? 1.0 : axis->GetBinUpEdge(bin);
+
+    low  = std::max(low, edges.back());
+    high = std::min(high, 1.0);
+
+    if (high <= low) continue;
+
+    Double_t weight = std::max(pdf->GetBinContent(bin), 0.0) * (high - low);
+
+    edges.push_back(high);
+    cumulative.push_back((cumulative.empty() ? 0.0 : cumulative.back()) + weight);
   }
 
+  if (cumulative.empty()) cumulative.push_back(0.0);
+
+  for (auto& c : cumulative) c /= std::max(cumulative.back(), 1e-300);
+}
+
+Double_t CaloEnergyCorrectorModule::InverseCDF::sample(Double_t u) const
+{
+  // First segment whose upper cumulative probability exceeds u; empty
+  // segments are never selected
+  size_t   segment = std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+
+  segment = std::min(segment, cumulative.size() - 1);
+
+  Double_t below = (segment == 0) ? 0.0 : cumulative[segment - 1];
+  Double_t width = cumulative[segment] - below;
+  Double_t f     = (width > 0.0) ? (u - below) / width : 0.0;
+
+  return edges[segment] + f * (edges[segment + 1] - edges[segment]);
+}
+
+Double_t CaloEnergyCorrectorModule::uniform(Long64_t entry, Int_t candidate)
+{
+  // splitmix64 of the entry, then of the candidate index
+  auto mix = [](std::uint64_t z) {
+               z += 0x9E3779B97F4A7C15ULL;
+               z  = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+               z  = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+               return z ^ (z >> 31);
+             };
+
+  std::uint64_t bits = mix(mix(std::uint64_t(entry)) + std::uint64_t(candidate));
+
+  // Top 53 bits as a double in [0, 1)
+  return (bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void CaloEnergyCorrectorModule::finalize()
+{}
+
+bool CaloEnergyCorrectorModule::execute(DataStore *store)
+{
+  auto data = getData();
+
+  TObjArray *inputTrackList = store->get(_inputTrackHandle);
+
+  // Entries are keyed by GenParticle address, which is reused from one event
+  // to the next; start from an empty map every event
+  _EMFractionMap->clear();
 
   // Apply refinements to the contents of the inputTrackList to generate the
   // outputTowerList
@@ -119,33 +185,11 @@ bool CaloEnergyCorrectorModule::execute(std::map<std::string, std::any> *DataSto
     Track *p = static_cast<Track *>(inputTrackList->At(i));
 
     Double_t emfrac = -1.0;
-      
-    Double_t CaloE = 0.0;
-    Double_t CaloH = 0.0;
 
-    std::vector<Tower *> track_towers;
-
-    for (Int_t t = 0; t < inputTowerList->GetEntries(); t++) {
-      auto calotower       = static_cast<Tower *>(inputTowerList->At(t));
-      auto tower_particles = calotower->Particles;
-
-      for (Int_t ref = 0; ref < tower_particles.GetEntries(); ref++) {
-        TRef calo_ref     = tower_particles.At(ref);
-        TObject *calo_obj = calo_ref.GetObject();
-
-        if ((p->Particle.GetObject() == nullptr) || (calo_obj == nullptr)) continue;
-
-        if (p->Particle.GetObject() == calo_ref.GetObject()) {
-          track_towers.push_back(calotower);
-        }
-      }
-    }
-
-
-    for (auto track_tower : track_towers) {
-      CaloE += track_tower->Eem;
-      CaloH += track_tower->Ehad;
-    }
+    // Energy in the towers associated with this track's particle
+    TObject *particle = p->Particle.GetObject();
+    Double_t CaloE    = _calo->Eem(particle);
+    Double_t CaloH    = _calo->Ehad(particle);
 
     if (CaloE + CaloH > 0.0) {
       emfrac = CaloE / (CaloE + CaloH);
@@ -161,43 +205,10 @@ bool CaloEnergyCorrectorModule::execute(std::map<std::string, std::any> *DataSto
 
       if ((TMath::Abs(pid) == 11) || (TMath::Abs(pid) == 211)) {
         // Correct using Full-Sim-based PDFs for calo. energy fractions
-        TString PDFname = "EMEnergyRatios_%s" + TString(Form("_%d_pdf", TMath::Abs(pid)));
-
-        if (p->Eta < -1.0) {
-          // Backward PDF
-          PDFname = Form(PDFname.Data(), "Backward");
-        } else if (TMath::Abs(p->Eta) <= 1.0) {
-          // Barrel PDF
-          PDFname = Form(PDFname.Data(), "Barrel");
-        } else if (TMath::Abs(p->Eta) > 1.0) {
-          // Forward PDF
-          PDFname = Form(PDFname.Data(), "Forward");
-        }
-
-        TH1D *pdf = static_cast<TH1D *>(_emfrac_file->Get(PDFname.Data()));
-
-        if (pdf == nullptr) {
-          std::stringstream message;
-          message << "EM Ratio PDF " << PDFname.Data()
-                  << " was not loaded correctly! [" << getName() << "::TreeWriterModule]" << std::endl;
-          throw std::runtime_error(message.str());
-        }
-
-        // Use accept-reject to set the EM fraction
-        Double_t max    = pdf->GetMaximum();
-        Bool_t   accept = false;
-
-        while (accept == false) {
-          Double_t x = gRandom->Uniform(0, 1);
-          Double_t y = gRandom->Uniform(0, max);
-
-          Double_t y_lookup = pdf->GetBinContent(pdf->FindBin(x));
-
-          if (y_lookup > y) {
-            emfrac = x;
-            accept = true;
-          }
-        }
+        Int_t region  = (p->Eta < -1.0) ? 0 : ((TMath::Abs(p->Eta) <= 1.0) ? 1 : 2);
+        Int_t species = (TMath::Abs(pid) == 11) ? 0 : 1;
+
+        emfrac = _emfrac_cdf[region][species].sample(uniform(getEntry(), i));
       }
     }
 
@@ -205,7 +216,5 @@ bool CaloEnergyCorrectorModule::execute(std::map<std::string, std::any> *DataSto
     (*_EMFractionMap)[p->Particle.GetObject()] = emfrac;
   }
 
-  (*DataStore)[_params["outputEMFractionMap"]] = _EMFractionMap;
-
   return true;
 }
@@ -15,8 +15,12 @@
 #include <iomanip>
 #include <fstream>
 #include <type_traits>
+#include <vector>
+
+#include "TH1.h"
 
 #include "Module.h"
+#include "CaloAssociation.h"
 #include "AnalysisFunctions.cc"
 
 
@@ -29,7 +33,7 @@ public:
   ~CaloEnergyCorrectorModule();
 
   void initialize() override;
-  bool execute(std::map<std::string, std::any> *DataStore) override;
+  bool execute(DataStore *store) override;
   void finalize() override;
 
 private:
@@ -40,12 +44,34 @@ private:
 
   // Internal correction of calorimeter energy distribution based on Full
   // Simulation
-  std::map<TObject*, Double_t> *_EMFractionMap = nullptr;
-  TFile *_emfrac_file                                  = nullptr;
+  EMFractionMap *_EMFractionMap = nullptr;
+
+  DataStore::Handle<TObjArray>_inputTrackHandle;
+  CaloAssociation *_calo = nullptr;
+  DataStore::Handle<EMFractionMap>_outputHandle;
+
+  // Cumulative distribution of one EM-fraction PDF over [0, 1], sampled by
+  // inverting it: one random number and a binary search per sample
+  struct InverseCDF {
+    std::vector<Double_t> edges;      // segment boundaries, from 0 to 1
+    std::vector<Double_t> cumulative; // probability below the upper edge of each segment
+
+    void     fill(TH1 *pdf);
+    Double_t sample(Double_t u) const;
+  };
+
+  // EM-fraction PDFs by region (Backward, Barrel, Forward) and species
+  // (electron, pion), loaded once at initialize
+  InverseCDF _emfrac_cdf[3][2];
 
 private:
 
   // Methods internal to the class
+
+  // Uniform number in [0, 1) that depends only on the entry and the
+  // candidate, so that results do not depend on which thread processed the
+  // event or in what order
+  static Double_t uniform(Long64_t entry, Int_t candidate);
 };
 
 
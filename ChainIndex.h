@@ -0,0 +1,158 @@
+#ifndef CHAININDEX_HH
+#define CHAININDEX_HH
+
+/**
+   Sidecar index of the input files: path, size, modification time and
+   number of "Delphes" entries. A file is opened only if it is not in the
+   index or if its size or mtime changed; otherwise its entry count comes
+   from the index, so a TChain can be built with TChain::Add(file, entries)
+   without opening anything. Files are then opened as the event loop reaches
+   them.
+ **/
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TSystem.h"
+
+class ChainIndex {
+public:
+
+  ChainIndex(std::string filename, std::string treename = "Delphes") {
+    _filename = filename;
+    _treename = treename;
+  }
+
+  // Read the index from disk; a missing index file is not an error
+  void load() {
+    std::ifstream in(_filename);
+
+    if (!in.good()) return;
+
+    std::string line;
+
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') continue;
+
+      std::stringstream fields(line);
+      std::string path, size, mtime, entries;
+
+      if (!std::getline(fields, path, '\t') || !std::getline(fields, size, '\t') ||
+          !std::getline(fields, mtime, '\t') || !std::getline(fields, entries, '\t')) {
+        std::cout << "ChainIndex: ignoring malformed line in " << _filename << ": " << line << std::endl;
+        continue;
+      }
+
+      // A field that is not a whole number (e.g. a line cut short when the
+      // index was written) drops the record; the file is then opened again
+      Record record;
+
+      if (!number(size, record.size) || !number(mtime, record.mtime) || !number(entries, record.entries)) {
+        std::cout << "ChainIndex: ignoring malformed line in " << _filename << ": " << line << std::endl;
+        continue;
+      }
+
+      _records[path] = record;
+    }
+  }
+
+  // Write the index back if any record was added or refreshed
+  void save() {
+    if (!_modified) return;
+
+    // Unique per process across the nodes that share the directory
+    std::string temporary = _filename + Form(".tmp%s.%d", gSystem->HostName(), gSystem->GetPid());
+    std::ofstream out(temporary);
+
+    out << "# path\tsize\tmtime\tentries" << std::endl;
+
+    for (auto record : _records) {
+      out << record.first << "\t" << record.second.size << "\t" << record.second.mtime
+          << "\t" << record.second.entries << std::endl;
+    }
+    out.close();
+
+    if (!out.good() || (gSystem->Rename(temporary.c_str(), _filename.c_str()) != 0)) {
+      std::cout << "ChainIndex: unable to write " << _filename << "; the index will be rebuilt next time" << std::endl;
+      gSystem->Unlink(temporary.c_str());
+      return;
+    }
+    _modified = false;
+  }
+
+  // Number of entries in a file, opening it only if the index is stale
+  Long64_t entries(std::string path) {
+    FileStat_t stat;
+    Bool_t     have_stat = (gSystem->GetPathInfo(path.c_str(), stat) == 0);
+
+    auto record = _records.find(path);
+
+    if (have_stat && (record != _records.end()) &&
+        (record->second.size == stat.fSize) && (record->second.mtime == stat.fMtime)) {
+      return record->second.entries;
+    }
+
+    TFile *file = TFile::Open(path.c_str());
+
+    if (file == nullptr || file->IsZombie()) {
+      std::stringstream message;
+      message << "Unable to open input file " << path << "! [ChainIndex]" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+
+    TTree   *tree = static_cast<TTree *>(file->Get(_treename.c_str()));
+    Long64_t n    = (tree != nullptr) ? tree->GetEntries() : 0;
+
+    file->Close();
+    delete file;
+
+    // Files that cannot be stat'ed (e.g. remote) are not indexed
+    if (have_stat) {
+      Record fresh;
+      fresh.size    = stat.fSize;
+      fresh.mtime   = stat.fMtime;
+      fresh.entries = n;
+
+      _records[path] = fresh;
+      _modified      = true;
+    }
+
+    return n;
+  }
+
+private:
+
+  struct Record {
+    Long64_t size    = -1;
+    Long_t   mtime   = -1;
+    Long64_t entries = 0;
+  };
+
+  // Parse a whole field as an integer; false if it is empty, has other
+  // characters or is out of range
+  template <class T>
+  static bool number(const std::string& field, T& value) {
+    try {
+      size_t used = 0;
+
+      value = std::stoll(field, &used);
+      return !field.empty() && (used == field.size());
+    } catch (const std::logic_error&) {
+      return false;
+    }
+  }
+
+  std::string _filename;
+  std::string _treename;
+  std::map<std::string, Record>_records;
+  Bool_t _modified = false;
+};
+
+#endif // ifndef CHAININDEX_HH
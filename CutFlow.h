@@ -0,0 +1,175 @@
+#ifndef CUTFLOW_HH
+#define CUTFLOW_HH
+
+/**
+   Cut flow of the module sequence. A module whose execute() returns false
+   rejects the event: the rest of the sequence is skipped and the event is
+   not written. The cut flow counts, for "All events" and then for every
+   module, the events that passed that step, unweighted and weighted by the
+   generator event weight; the events that reached a step are those that
+   passed the previous one. Cut flows of several threads are merged step by
+   step, and the copies written to the output file add up under hadd.
+ **/
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+#include "TH1D.h"
+#include "TDirectory.h"
+
+class CutFlow {
+public:
+
+  CutFlow() {
+    addStep("All events");
+  }
+
+  CutFlow(const CutFlow&)            = delete;
+  CutFlow& operator=(const CutFlow&) = delete;
+
+  // Register a step; the returned index is passed to pass()
+  Int_t addStep(std::string name) {
+    Step step;
+
+    step.name = name;
+    _steps.push_back(step);
+    return _steps.size() - 1;
+  }
+
+  // Count an event that passed a step
+  void pass(Int_t step, Double_t weight = 1.0) {
+    _steps[step].events   += 1;
+    _steps[step].weighted += weight;
+    _steps[step].weighted2 += weight * weight;
+  }
+
+  // Add the counts of another cut flow, matching steps by name
+  void merge(const CutFlow& other) {
+    for (auto theirs : other._steps) {
+      Int_t index = step(theirs.name);
+
+      _steps[index].events    += theirs.events;
+      _steps[index].weighted  += theirs.weighted;
+      _steps[index].weighted2 += theirs.weighted2;
+    }
+  }
+
+  // Add the counts that writeHistograms() put in a file (e.g. the output of
+  // a worker process), matching steps by bin label
+  void readHistograms(TDirectory *file) {
+    TDirectory *dir = file->GetDirectory("CutFlow");
+
+    if (dir == nullptr) return;
+
+    TH1D *events   = dir->Get<TH1D>("CutFlow_events");
+    TH1D *weighted = dir->Get<TH1D>("CutFlow_weighted");
+
+    if ((events == nullptr) || (weighted == nullptr)) return;
+
+    for (Int_t bin = 1; bin <= events->GetNbinsX(); bin++) {
+      Int_t index = step(events->GetXaxis()->GetBinLabel(bin));
+
+      _steps[index].events    += std::llround(events->GetBinContent(bin));
+      _steps[index].weighted  += weighted->GetBinContent(bin);
+      _steps[index].weighted2 += std::pow(weighted->GetBinError(bin), 2);
+    }
+  }
+
+  void print() {
+    std::cout << "=============================== Cut Flow ===============================" << std::endl;
+    std::cout << std::left << std::setw(28) << "Step" << std::right
+              << std::setw(12) << "Passed"
+              << std::setw(12) << "Failed"
+              << std::setw(14) << "Weighted"
+              << std::setw(12) << "Eff." << std::endl;
+
+    for (size_t s = 0; s < _steps.size(); s++) {
+      Long64_t in = (s == 0) ? _steps[s].events : _steps[s - 1].events;
+
+      std::cout << std::left << std::setw(28) << _steps[s].name << std::right
+                << std::setw(12) << _steps[s].events
+                << std::setw(12) << in - _steps[s].events
+                << std::setw(14) << _steps[s].weighted
+                << std::setw(12) << ((in > 0) ? Double_t(_steps[s].events) / in : 0.0) << std::endl;
+    }
+  }
+
+  void writeCSV(std::string filename) {
+    std::ofstream out(filename);
+
+    out << std::setprecision(9);
+    out << "step,name,events_in,events_passed,events_failed,weighted_in,weighted_passed,weighted_failed" << std::endl;
+
+    for (size_t s = 0; s < _steps.size(); s++) {
+      const Step& in = (s == 0) ? _steps[s] : _steps[s - 1];
+
+      out << s << "," << _steps[s].name << ","
+          << in.events << "," << _steps[s].events << "," << in.events - _steps[s].events << ","
+          << in.weighted << "," << _steps[s].weighted << "," << in.weighted - _steps[s].weighted << std::endl;
+    }
+
+    if (!out.good()) {
+      std::cout << "CutFlow: unable to write " << filename << std::endl;
+    }
+  }
+
+  // Write the passed counts, one labelled bin per step, into a "CutFlow"
+  // directory of the given file, replacing those of an earlier write
+  void writeHistograms(TDirectory *file) {
+    Int_t nsteps   = _steps.size();
+    TH1D *events   = new TH1D("CutFlow_events", "Cut flow;;events passed", nsteps, 0, nsteps);
+    TH1D *weighted = new TH1D("CutFlow_weighted", "Cut flow;;weighted events passed", nsteps, 0, nsteps);
+
+    events->SetDirectory(nullptr);
+    weighted->SetDirectory(nullptr);
+
+    for (Int_t s = 0; s < nsteps; s++) {
+      events->GetXaxis()->SetBinLabel(s + 1, _steps[s].name.c_str());
+      weighted->GetXaxis()->SetBinLabel(s + 1, _steps[s].name.c_str());
+
+      events->SetBinContent(s + 1, _steps[s].events);
+      events->SetBinError(s + 1, std::sqrt(Double_t(_steps[s].events)));
+      weighted->SetBinContent(s + 1, _steps[s].weighted);
+      weighted->SetBinError(s + 1, std::sqrt(_steps[s].weighted2));
+    }
+    events->SetEntries(_steps[0].events);
+    weighted->SetEntries(_steps[0].events);
+
+    TDirectory *dir = file->GetDirectory("CutFlow");
+
+    if (dir == nullptr) dir = file->mkdir("CutFlow");
+
+    dir->cd();
+    events->Write("", TObject::kOverwrite);
+    weighted->Write("", TObject::kOverwrite);
+    file->cd();
+
+    delete events;
+    delete weighted;
+  }
+
+private:
+
+  struct Step {
+    std::string name;
+    Long64_t    events    = 0;
+    Double_t    weighted  = 0.0;
+    Double_t    weighted2 = 0.0;
+  };
+
+  // Index of the step with this name, added if there is none
+  Int_t step(std::string name) {
+    for (size_t s = 0; s < _steps.size(); s++) {
+      if (_steps[s].name == name) return s;
+    }
+    return addStep(name);
+  }
+
+  std::vector<Step>_steps;
+};
+
+#endif // ifndef CUTFLOW_HH
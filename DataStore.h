@@ -0,0 +1,288 @@
+#ifndef DATASTORE_HH
+#define DATASTORE_HH
+
+/**
+   Per-thread store of the lists (and other objects) exchanged between
+   modules. Every entry is registered once, before the event loop, under a
+   name and a type; registration hands back an integer handle. During the
+   event loop, modules put and get values through their handles only: a
+   lookup is an index into a vector, with no string comparison, no
+   allocation and no type probing.
+
+   Producers book() the names they write; consumers find() the names they
+   read. Both should be done in Module::initialize(), which runs in
+   ExecutionPath order, so a consumer finds the entries of every producer
+   that runs before it.
+
+   find() also declares what the consumer reads: the entry itself and,
+   optionally, the subset of object data members ("leaves") it uses. An
+   empty leaf list means all of them. After initialization, OLeAA only reads
+   the input branches, and branch leaves, that some module declared.
+
+   Objects made during an event belong to the store, not to the modules:
+   bookList() lists and create()'d candidates are released together by
+   endEvent(). Candidates live in one TClonesArray per class, so their
+   memory is reused from event to event instead of being allocated anew.
+
+   Per-event services built from the lists (tower associations, matchers,
+   column views, ...) are shared by all their consumers through shared():
+   the first request makes the object, the store owns it and calls its
+   reset() at every endEvent().
+ **/
+
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <typeinfo>
+#include <typeindex>
+#include <functional>
+#include <memory>
+
+#include "TObject.h"
+#include "TObjArray.h"
+#include "TClonesArray.h"
+
+// Calorimeter EM fraction, keyed by GenParticle
+typedef std::map<TObject *, Double_t> EMFractionMap;
+
+class DataStore {
+public:
+
+  template <class T>
+  class Handle {
+    friend class DataStore;
+
+    Int_t _index = -1;
+
+  public:
+
+    Bool_t isValid() const {
+      return _index >= 0;
+    }
+  };
+
+  DataStore() {}
+
+  ~DataStore() {
+    // Shared objects may refer to those made before them
+    while (!_shared.empty()) _shared.pop_back();
+
+    for (auto list : _event_lists) delete list;
+    for (auto pool : _pools) delete pool.second;
+  }
+
+  // Register a new entry of type T. Entries cannot be booked twice.
+  template <class T>
+  Handle<T>book(std::string name, std::string requester = "") {
+    if (contains(name)) {
+      std::stringstream message;
+      message << "An object named " << name << " already exists in the DataStore! [" << requester << "]" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+
+    Handle<T> handle;
+    handle._index = _slots.size();
+
+    _slots.push_back(nullptr);
+    _types.push_back(std::type_index(typeid(T)));
+    _names.push_back(name);
+    _parents.push_back(-1);
+    _used.push_back(kFALSE);
+    _leaves.push_back(std::set<std::string>());
+    _classes.push_back("");
+    _index[name] = handle._index;
+
+    return handle;
+  }
+
+  // Register a list owned by the DataStore; it is emptied by endEvent()
+  Handle<TObjArray>bookList(std::string name, std::string requester = "") {
+    Handle<TObjArray> handle = book<TObjArray>(name, requester);
+    TObjArray *list = new TObjArray();
+
+    _event_lists.push_back(list);
+    put(handle, list);
+
+    return handle;
+  }
+
+  // Declare that an entry is built from the objects of another one (e.g. a
+  // refined list). Whatever is read from the output is then read from the
+  // input as well.
+  template <class T>
+  void derive(Handle<T>output, Handle<T>input) {
+    _parents[output._index] = input._index;
+  }
+
+  // Look up an entry that must already be booked with type T, declaring the
+  // leaves the requester reads (all of them if none are given).
+  template <class T>
+  Handle<T>find(std::string name, std::string requester = "", std::vector<std::string>leaves = {}) {
+    Handle<T> handle = findOptional<T>(name, leaves);
+
+    if (!handle.isValid()) {
+      std::stringstream message;
+      message << "Unable to locate " << name << " in the DataStore! [" << requester << "]" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+
+    return handle;
+  }
+
+  // Look up an entry that may not exist; the returned handle is invalid if
+  // it does not.
+  template <class T>
+  Handle<T>findOptional(std::string name, std::vector<std::string>leaves = {}) {
+    Handle<T> handle;
+
+    if (!contains(name)) return handle;
+
+    Int_t index = _index[name];
+
+    if (_types[index] != std::type_index(typeid(T))) {
+      std::stringstream message;
+      message << "DataStore object " << name << " is not of the requested type " << typeid(T).name() << "!" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+
+    handle._index = index;
+    markUsed(index, leaves);
+    return handle;
+  }
+
+  // Whether any consumer found this entry (directly or through a derived one)
+  Bool_t isUsed(std::string name) {
+    return contains(name) && _used[_index[name]];
+  }
+
+  // Leaves declared by the consumers of this entry; empty means all leaves
+  std::set<std::string>getLeaves(std::string name) {
+    return _leaves[_index[name]];
+  }
+
+  // Class of the objects of an entry, as set for the input branches; a
+  // derived entry has the class of its input. Empty if unknown.
+  void setClassName(std::string name, std::string className) {
+    _classes[_index[name]] = className;
+  }
+
+  std::string getClassName(std::string name) {
+    if (!contains(name)) return "";
+
+    Int_t index = _index[name];
+
+    while (_classes[index].empty() && (_parents[index] >= 0)) index = _parents[index];
+    return _classes[index];
+  }
+
+  Bool_t contains(std::string name) {
+    return _index.find(name) != _index.end();
+  }
+
+  std::string getName(Int_t index) {
+    return _names[index];
+  }
+
+  template <class T>
+  void put(Handle<T>handle, T *value) {
+    _slots[handle._index] = value;
+  }
+
+  // Invalid (optional, absent) handles yield nullptr
+  template <class T>
+  T* get(Handle<T>handle) const {
+    if (handle._index < 0) return nullptr;
+
+    return static_cast<T *>(_slots[handle._index]);
+  }
+
+  // A new object of class T that lives until endEvent()
+  template <class T>
+  T* create() {
+    TClonesArray *pool = getPool<T>();
+
+    return new ((*pool)[pool->GetEntriesFast()]) T();
+  }
+
+  // A copy of an object, living until endEvent()
+  template <class T>
+  T* create(const T& original) {
+    TClonesArray *pool = getPool<T>();
+
+    return new ((*pool)[pool->GetEntriesFast()]) T(original);
+  }
+
+  // The object of class T shared under this name, made by factory() on the
+  // first request. The store owns it and calls its reset() at every
+  // endEvent(); T declares DataStore a friend if reset() is private.
+  template <class T, class Factory>
+  T* shared(std::string name, std::string requester, Factory factory) {
+    if (contains(name)) return get(find<T>(name, requester));
+
+    T *object = factory();
+
+    _shared.push_back(std::unique_ptr<void, void (*)(void *)>(object, [](void *p) { delete static_cast<T *>(p); }));
+    put(book<T>(name, requester), object);
+    onEndEvent([object]() { object->reset(); });
+
+    return object;
+  }
+
+  // Have a function called by every endEvent(), e.g. to drop per-event caches
+  void onEndEvent(std::function<void()>callback) {
+    _end_event_callbacks.push_back(callback);
+  }
+
+  // Release everything made during the event: owned lists are emptied and
+  // created objects destroyed, keeping their memory for the next event
+  void endEvent() {
+    for (auto list : _event_lists) list->Clear();
+    for (auto pool : _pools) pool.second->Delete();
+    for (auto callback : _end_event_callbacks) callback();
+  }
+
+private:
+
+  template <class T>
+  TClonesArray* getPool() {
+    auto pool = _pools.find(std::type_index(typeid(T)));
+
+    if (pool != _pools.end()) return pool->second;
+
+    TClonesArray *array = new TClonesArray(T::Class());
+    _pools[std::type_index(typeid(T))] = array;
+    return array;
+  }
+
+  void markUsed(Int_t index, const std::vector<std::string>& leaves) {
+    Bool_t all = leaves.empty() || (_used[index] && _leaves[index].empty());
+
+    if (all) {
+      _leaves[index].clear();
+    } else {
+      _leaves[index].insert(leaves.begin(), leaves.end());
+    }
+    _used[index] = kTRUE;
+
+    if (_parents[index] >= 0) markUsed(_parents[index], leaves);
+  }
+
+  std::vector<void *>_slots;
+  std::vector<std::type_index>_types;
+  std::vector<std::string>_names;
+  std::vector<Int_t>_parents;
+  std::vector<Bool_t>_used;
+  std::vector<std::set<std::string> >_leaves;
+  std::vector<std::string>_classes;
+  std::map<std::string, Int_t>_index;
+
+  std::vector<TObjArray *>_event_lists;
+  std::map<std::type_index, TClonesArray *>_pools;
+  std::vector<std::function<void()> >_end_event_callbacks;
+  std::vector<std::unique_ptr<void, void (*)(void *)> >_shared;
+};
+
+#endif // ifndef DATASTORE_HH
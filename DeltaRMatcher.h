@@ -0,0 +1,392 @@
+#ifndef DELTARMATCHER_HH
+#define DELTARMATCHER_HH
+
+/**
+   Delta-R matching of candidates to the objects of a target list (GenJet,
+   Particle, ...). Once per event, on the first query, the targets are
+   binned in an eta-phi grid (phi wraps around); a query only visits the
+   cells around the candidate, ring by ring, and stops as soon as no
+   unvisited cell can hold a closer target.
+
+   Three kinds of query are supported, all cached for the event:
+   * best(candidate):   closest target within the cone
+   * unique(list):      one-to-one greedy assignment, closest pairs first
+   * cone(candidate):   all targets within the cone
+
+   Modules get a shared matcher in their initialize() with
+   DeltaRMatcher::get(store, targetList, maxDR, sameCharge, requester).
+   Matchers with the same settings share their cache; all matchers of a
+   target list share its grid.
+ **/
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include <cmath>
+
+#include "TObject.h"
+#include "TObjArray.h"
+#include "TMath.h"
+#include "TString.h"
+
+#include "classes/DelphesClasses.h"
+#include "DataStore.h"
+
+class EtaPhiGrid {
+  friend class DataStore;
+
+public:
+
+  static EtaPhiGrid* get(DataStore *store, std::string list, std::string requester = "") {
+    std::string name = "EtaPhiGrid:" + list;
+
+    return store->shared<EtaPhiGrid>(name, requester, [&]() { return new EtaPhiGrid(store, list, requester); });
+  }
+
+  // Eta, phi and charge of any Delphes candidate class with these members
+  static Bool_t kinematics(TObject *obj, Double_t& eta, Double_t& phi, Int_t& charge) {
+    TClass *type = obj->IsA();
+
+    charge = 0;
+
+    if (type == GenParticle::Class()) {
+      auto p = static_cast<GenParticle *>(obj);
+      eta = p->Eta; phi = p->Phi; charge = p->Charge;
+    } else if (type == Jet::Class()) {
+      auto p = static_cast<Jet *>(obj);
+      eta = p->Eta; phi = p->Phi; charge = p->Charge;
+    } else if (type == Track::Class()) {
+      auto p = static_cast<Track *>(obj);
+      eta = p->Eta; phi = p->Phi; charge = p->Charge;
+    } else if (type == Electron::Class()) {
+      auto p = static_cast<Electron *>(obj);
+      eta = p->Eta; phi = p->Phi; charge = p->Charge;
+    } else if (type == Muon::Class()) {
+      auto p = static_cast<Muon *>(obj);
+      eta = p->Eta; phi = p->Phi; charge = p->Charge;
+    } else if (type == Photon::Class()) {
+      auto p = static_cast<Photon *>(obj);
+      eta = p->Eta; phi = p->Phi;
+    } else {
+      return kFALSE;
+    }
+    return kTRUE;
+  }
+
+  static Double_t deltaR(Double_t eta1, Double_t phi1, Double_t eta2, Double_t phi2) {
+    Double_t dphi = wrapPhi(phi1 - phi2);
+
+    return std::sqrt((eta1 - eta2) * (eta1 - eta2) + dphi * dphi);
+  }
+
+  // Closest accepted target within maxDR, or -1. Ties go to the target
+  // earlier in the list.
+  Int_t nearest(Double_t eta, Double_t phi, Double_t maxDR, std::function<Bool_t(Int_t)>accept = nullptr, Double_t *bestDR = nullptr) {
+    if (!_built) build();
+
+    Int_t    best   = -1;
+    Double_t min_dR = maxDR;
+
+    visit(eta, phi, maxDR, [&](Int_t i) {
+            Double_t dR = deltaR(eta, phi, _eta[i], _phi[i]);
+
+            if ((dR < min_dR || (dR == min_dR && best >= 0 && i < best)) && (!accept || accept(i))) {
+              min_dR = dR;
+              best   = i;
+            }
+          }, [&](Int_t ring) {
+            // Cells beyond this ring are more than ring * cell size away
+            return (best >= 0) && (min_dR < ring * _cell);
+          });
+
+    if (bestDR != nullptr) *bestDR = min_dR;
+    return best;
+  }
+
+  // All targets within R, with their distances, in list order
+  std::vector<std::pair<Int_t, Double_t> >within(Double_t eta, Double_t phi, Double_t R) {
+    if (!_built) build();
+
+    std::vector<std::pair<Int_t, Double_t> > found;
+
+    visit(eta, phi, R, [&](Int_t i) {
+            Double_t dR = deltaR(eta, phi, _eta[i], _phi[i]);
+
+            if (dR < R) found.push_back(std::make_pair(i, dR));
+          });
+
+    std::sort(found.begin(), found.end());
+    return found;
+  }
+
+  TObject* at(Int_t i) {
+    return _store->get(_input)->At(i);
+  }
+
+  Int_t charge(Int_t i) {
+    return _charge[i];
+  }
+
+private:
+
+  EtaPhiGrid(DataStore *store, std::string list, std::string requester) {
+    _store = store;
+    _input = store->find<TObjArray>(list, requester, { "Eta", "Phi", "Charge" });
+  }
+
+  static Double_t wrapPhi(Double_t dphi) {
+    while (dphi >= TMath::Pi()) dphi -= TMath::TwoPi();
+    while (dphi < -TMath::Pi()) dphi += TMath::TwoPi();
+    return dphi;
+  }
+
+  Int_t etaBin(Double_t eta) {
+    Int_t bin = Int_t(std::floor((eta + _eta_max) / _cell));
+
+    return std::max(0, std::min(_neta - 1, bin));
+  }
+
+  Int_t phiBin(Double_t phi) {
+    Int_t bin = Int_t(std::floor((wrapPhi(phi) + TMath::Pi()) / _phi_cell));
+
+    return ((bin % _nphi) + _nphi) % _nphi;
+  }
+
+  // Call f(target) for the targets in rings of cells of growing Chebyshev
+  // distance around (eta, phi), up to the cells that can hold a target
+  // within R or until done(ring) returns true after a complete ring
+  void visit(Double_t eta, Double_t phi, Double_t R, std::function<void(Int_t)>f,
+             std::function<Bool_t(Int_t)>done = nullptr) {
+    Int_t e0 = etaBin(eta);
+    Int_t p0 = phiBin(phi);
+    Int_t max_ring = std::max(_neta, _nphi);
+
+    if (R < max_ring * _cell) max_ring = std::min(max_ring, Int_t(std::ceil(R / _cell)) + 1);
+
+    _stamp++;
+
+    for (Int_t ring = 0; ring <= max_ring; ring++) {
+      for (Int_t de = -ring; de <= ring; de++) {
+        Int_t e = e0 + de;
+
+        if ((e < 0) || (e >= _neta)) continue;
+
+        for (Int_t dp = -ring; dp <= ring; dp++) {
+          if ((std::abs(de) != ring) && (std::abs(dp) != ring)) continue;
+
+          Int_t cell = e * _nphi + (((p0 + dp) % _nphi) + _nphi) % _nphi;
+
+          if (_visited[cell] == _stamp) continue;
+          _visited[cell] = _stamp;
+
+          for (Int_t k = _cell_start[cell]; k < _cell_start[cell + 1]; k++) f(_items[k]);
+        }
+      }
+      if (done && done(ring)) return;
+    }
+  }
+
+  void build() {
+    TObjArray *list = _store->get(_input);
+    Int_t n = (list != nullptr) ? list->GetEntriesFast() : 0;
+
+    _eta.assign(n, 0.0);
+    _phi.assign(n, 0.0);
+    _charge.assign(n, 0);
+
+    std::vector<Int_t> cell_of(n, -1);
+    _cell_start.assign(_neta * _nphi + 1, 0);
+
+    for (Int_t i = 0; i < n; i++) {
+      if (!kinematics(list->At(i), _eta[i], _phi[i], _charge[i])) continue;
+
+      cell_of[i] = etaBin(_eta[i]) * _nphi + phiBin(_phi[i]);
+      _cell_start[cell_of[i] + 1]++;
+    }
+
+    for (size_t c = 1; c < _cell_start.size(); c++) _cell_start[c] += _cell_start[c - 1];
+
+    // Fill the cells in list order, so ties resolve as a linear scan would
+    std::vector<Int_t> fill(_cell_start.begin(), _cell_start.end() - 1);
+    _items.assign(_cell_start.back(), -1);
+
+    for (Int_t i = 0; i < n; i++) {
+      if (cell_of[i] >= 0) _items[fill[cell_of[i]]++] = i;
+    }
+
+    if (_visited.size() != _cell_start.size()) _visited.assign(_cell_start.size(), 0);
+    _built = kTRUE;
+  }
+
+  void reset() {
+    _built = kFALSE;
+  }
+
+  DataStore *_store = nullptr;
+  DataStore::Handle<TObjArray>_input;
+  Bool_t _built = kFALSE;
+
+  // 0.2 x 0.2 cells over |eta| < 6; objects beyond go to the edge cells
+  const Double_t _cell     = 0.2;
+  const Double_t _eta_max  = 6.0;
+  const Int_t    _neta     = 60;
+  const Int_t    _nphi     = Int_t(TMath::TwoPi() / 0.2);
+  const Double_t _phi_cell = TMath::TwoPi() / Int_t(TMath::TwoPi() / 0.2);
+
+  std::vector<Double_t>_eta;
+  std::vector<Double_t>_phi;
+  std::vector<Int_t>_charge;
+  std::vector<Int_t>_cell_start;
+  std::vector<Int_t>_items;
+  std::vector<Int_t>_visited;
+  Int_t _stamp = 0;
+};
+
+class DeltaRMatcher {
+  friend class DataStore;
+
+public:
+
+  static DeltaRMatcher* get(DataStore *store, std::string targetList, Double_t maxDR, Bool_t sameCharge, std::string requester = "") {
+    std::string name = Form("DeltaRMatcher:%s:%g:%d", targetList.c_str(), maxDR, sameCharge);
+
+    return store->shared<DeltaRMatcher>(name, requester, [&]() {
+                                          return new DeltaRMatcher(EtaPhiGrid::get(store, targetList, requester), maxDR, sameCharge);
+                                        });
+  }
+
+  // Closest target within the cone, or nullptr
+  TObject* best(TObject *candidate) {
+    auto cached = _best.find(candidate);
+
+    if (cached != _best.end()) return cached->second;
+
+    TObject *match = nullptr;
+    Double_t eta, phi;
+    Int_t    charge;
+
+    if (EtaPhiGrid::kinematics(candidate, eta, phi, charge)) {
+      Int_t i = _grid->nearest(eta, phi, _maxDR, accept(charge));
+
+      if (i >= 0) match = _grid->at(i);
+    }
+
+    _best[candidate] = match;
+    return match;
+  }
+
+  // One-to-one assignment of the candidates of a list, closest pairs first
+  // (greedy); candidates left without a target map to nullptr. The
+  // assignment is made once per list and event.
+  TObject* unique(TObject *candidate, TObjArray *list) {
+    auto assigned = _unique.find(list);
+
+    if (assigned == _unique.end()) assigned = _unique.emplace(list, assign(list)).first;
+
+    auto match = assigned->second.find(candidate);
+
+    return (match != assigned->second.end()) ? match->second : nullptr;
+  }
+
+  // All targets within the cone, closest first
+  const std::vector<TObject *>& cone(TObject *candidate) {
+    auto cached = _cone.find(candidate);
+
+    if (cached != _cone.end()) return cached->second;
+
+    std::vector<TObject *>& targets = _cone[candidate];
+    Double_t eta, phi;
+    Int_t    charge;
+
+    if (EtaPhiGrid::kinematics(candidate, eta, phi, charge)) {
+      auto accepted = accept(charge);
+
+      auto found = _grid->within(eta, phi, _maxDR);
+
+      std::stable_sort(found.begin(), found.end(), [](const std::pair<Int_t, Double_t>& a, const std::pair<Int_t, Double_t>& b) {
+                         return a.second < b.second;
+                       });
+
+      for (auto target : found) {
+        if (!accepted || accepted(target.first)) targets.push_back(_grid->at(target.first));
+      }
+    }
+    return targets;
+  }
+
+private:
+
+  DeltaRMatcher(EtaPhiGrid *grid, Double_t maxDR, Bool_t sameCharge) {
+    _grid       = grid;
+    _maxDR      = maxDR;
+    _sameCharge = sameCharge;
+  }
+
+  std::function<Bool_t(Int_t)>accept(Int_t charge) {
+    if (!_sameCharge) return nullptr;
+
+    EtaPhiGrid *grid = _grid;
+    return [grid, charge](Int_t i) {
+             return grid->charge(i) == charge;
+           };
+  }
+
+  std::unordered_map<TObject *, TObject *>assign(TObjArray *list) {
+    struct Pair {
+      Double_t dR;
+      Int_t    candidate;
+      Int_t    target;
+    };
+    std::vector<Pair> pairs;
+    std::unordered_map<TObject *, TObject *> assignment;
+
+    for (Int_t c = 0; c < list->GetEntriesFast(); c++) {
+      Double_t eta, phi;
+      Int_t    charge;
+
+      assignment[list->At(c)] = nullptr;
+
+      if (!EtaPhiGrid::kinematics(list->At(c), eta, phi, charge)) continue;
+
+      auto accepted = accept(charge);
+
+      for (auto found : _grid->within(eta, phi, _maxDR)) {
+        if (!accepted || accepted(found.first)) pairs.push_back({ found.second, c, found.first });
+      }
+    }
+
+    std::stable_sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) {
+                       return a.dR < b.dR;
+                     });
+
+    std::vector<Bool_t> candidate_used(list->GetEntriesFast(), kFALSE);
+    std::unordered_map<Int_t, Bool_t> target_used;
+
+    for (auto pair : pairs) {
+      if (candidate_used[pair.candidate] || target_used[pair.target]) continue;
+
+      candidate_used[pair.candidate] = kTRUE;
+      target_used[pair.target]       = kTRUE;
+      assignment[list->At(pair.candidate)] = _grid->at(pair.target);
+    }
+    return assignment;
+  }
+
+  void reset() {
+    _best.clear();
+    _cone.clear();
+    _unique.clear();
+  }
+
+  EtaPhiGrid *_grid = nullptr;
+  Double_t _maxDR;
+  Bool_t _sameCharge;
+
+  std::unordered_map<TObject *, TObject *>_best;
+  std::unordered_map<TObject *, std::vector<TObject *> >_cone;
+  std::unordered_map<TObjArray *, std::unordered_map<TObject *, TObject *> >_unique;
+};
+
+#endif // ifndef DELTARMATCHER_HH
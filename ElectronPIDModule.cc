@@ -13,7 +13,6 @@ ElectronPIDModule::ElectronPIDModule(ExRootTreeReader *data, std::string name)
   : Module(data, name)
 {
   _params = std::map<std::string, std::string>();
-  _outputList    = new TObjArray();
   _electron_mass = TDatabasePDG().GetParticle(11)->Mass();
 }
 
@@ -43,54 +42,33 @@ void ElectronPIDModule::initialize()
       std::cout << getName() << "::" << r << ": value set to " << _params[r] << std::endl;
     }
   }
-  
-}
-
-bool ElectronPIDModule::execute(std::map<std::string, std::any> *DataStore)
-{
-  auto data = getData();
-
 
-  if (DataStore->find(_params["outputList"]) != DataStore->end()) {
-    std::stringstream message;
-    message << "Cannot overwrite existing list ChargedElectron [" << getName() << "::ElectronPIDModule]" << std::endl;
-    throw std::runtime_error(message.str());
-  }
+  // Establish the selection for electrons
+  ExRootConfParam p = getConfiguration()->GetParam(Form("%s::%s", getName().c_str(), "fEM_min"));
 
-  if ((_outputList != nullptr) && (_outputList->GetEntries() > 0)) {
-    for (Int_t i = 0; i < _outputList->GetEntries(); i++) {
-      delete _outputList->At(i);
-    }
-    _outputList->Clear();
+  if (p.GetSize() > 0) {
+    _fEM_min = p.GetDouble();
   }
 
+  // Resolve the input lists and register the output list. The generated
+  // particles are needed to resolve the track and tower references.
+  DataStore *store = getDataStore();
+
+  _calo         = CaloAssociation::get(store, "Tower", getName() + "::ElectronPIDModule");
+  _inputHandle  = store->find<TObjArray>(_params["inputList"], getName() + "::ElectronPIDModule",
+                                         { "PT", "Eta", "Phi", "Mass", "Charge", "D0", "DZ", "ErrorD0", "ErrorDZ", "Particle" });
+  store->find<TObjArray>("Particle", getName() + "::ElectronPIDModule", { "PID" });
+  _emfracHandle = store->find<EMFractionMap>("EMFracMap", getName() + "::ElectronPIDModule");
+  _outputHandle = store->bookList(_params["outputList"], getName() + "::ElectronPIDModule");
+  _outputList   = store->get(_outputHandle);
+}
 
-  if (((*DataStore).find("Tower") == (*DataStore).end()) ||
-      ((*DataStore).find(_params["inputList"]) == (*DataStore).end())) {
-    std::stringstream message;
-    message << "Missing input lists requested from the DataStore! [" << getName() << "::ElectronPIDModule]" << std::endl;
-    throw std::runtime_error(message.str());
-  }
+bool ElectronPIDModule::execute(DataStore *store)
+{
+  auto data = getData();
 
-  auto CaloTower  = std::any_cast<TClonesArray *>((*DataStore)["Tower"]);
-  TObjArray* EFlowTrack = nullptr;
-  
-  
-  try {
-    EFlowTrack = std::any_cast<TObjArray *>((*DataStore)[_params["inputList"]]);
-  } catch (const std::bad_any_cast& e)
-    {
-      try {
-	EFlowTrack = std::any_cast<TClonesArray *>((*DataStore)[_params["inputList"]]);
-      } catch (const std::bad_any_cast& e)
-        {
-          std::stringstream message;
-          message << "Input list " << _params["inputList"]
-                  << " must be either TObjArray or TClonesArray! [" << getName() << "::execute]" << std::endl;
-          throw std::runtime_error(message.str());
-        }
-    }
-  
+  TObjArray* EFlowTrack = store->get(_inputHandle);
+  auto EMFracMap        = store->get(_emfracHandle);
 
   // Loop over EFlowTracks. Store for each the EM and HAD energy in the
   // associated
@@ -103,42 +81,11 @@ bool ElectronPIDModule::execute(std::map<std::string, std::any> *DataStore)
 
     // if (TMath::Abs(eflowtrack->PID)!=11)
     //   continue;
-    std::vector<Tower *> track_towers;
-
-    for (Int_t t = 0; t < CaloTower->GetEntries(); t++) {
-      auto calotower       = static_cast<Tower *>(CaloTower->At(t));
-      auto tower_particles = calotower->Particles;
-
-      for (Int_t ref = 0; ref < tower_particles.GetEntries(); ref++) {
-        TRef track_ref    = eflowtrack->Particle;
-        TRef calo_ref     = tower_particles.At(ref);
-        TObject *calo_obj = calo_ref.GetObject();
-
-        if ((track_ref.GetObject() == nullptr) || (calo_obj == nullptr)) continue;
-
-        if (track_ref.GetObject() == calo_ref.GetObject()) {
-          track_towers.push_back(calotower);
-        }
-      }
-    }
-
-
-    Double_t Eem  = 0.0;
-    Double_t Ehad = 0.0;
-
-    for (auto track_tower : track_towers) {
-      // std::cout << "E(EM, HAD) = " << track_tower->Eem << ", " <<
-      // track_tower->Ehad << std::endl;
-      Eem  += track_tower->Eem;
-      Ehad += track_tower->Ehad;
-    }
-
-    // Establish the selection for electrons
-    ExRootConfParam p = getConfiguration()->GetParam(Form("%s::%s", getName().c_str(), "fEM_min"));
+    TObject *particle = eflowtrack->Particle.GetObject();
+    Double_t Eem      = _calo->Eem(particle);
+    Double_t Ehad     = _calo->Ehad(particle);
 
     Double_t fEM     = Eem / (Eem + Ehad);
-    
-    auto EMFracMap = std::any_cast<std::map<TObject *, Double_t>* >((*DataStore)["EMFracMap"]);
 
     if (EMFracMap->find(eflowtrack->Particle.GetObject()) != EMFracMap->end()) {
       fEM = (*EMFracMap)[eflowtrack->Particle.GetObject()];
@@ -147,20 +94,14 @@ bool ElectronPIDModule::execute(std::map<std::string, std::any> *DataStore)
       Ehad = Etotal * (1.0 - fEM);
    }
 
-    Double_t fEM_min = 0.0;
-
-    if (p.GetSize() > 0) {
-      fEM_min = p.GetDouble();
-    }
-
     Bool_t passesSelection = kTRUE;
 
-    if (fEM < fEM_min) {
+    if (fEM < _fEM_min) {
       passesSelection &= kFALSE;
     }
 
     if (passesSelection) {
-      Electron *electron = new Electron(); // static_cast<Track*>(eflowtrack->Clone());
+      Electron *electron = store->create<Electron>();
 
       // Correct the 4-vector for the mass
       TLorentzVector p4 = eflowtrack->P4();
@@ -186,8 +127,5 @@ bool ElectronPIDModule::execute(std::map<std::string, std::any> *DataStore)
   }
 
 
-  (*DataStore)[_params["outputList"]] = _outputList;
-
-
   return true;
 }
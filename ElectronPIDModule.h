@@ -20,6 +20,7 @@
 
 // Other includes
 #include "Module.h"
+#include "CaloAssociation.h"
 #include "AnalysisFunctions.cc"
 #include "classes/DelphesClasses.h"
 
@@ -33,14 +34,20 @@ class ElectronPIDModule : public Module {
   ~ElectronPIDModule();
 
   void initialize() override;
-  bool execute(std::map<std::string, std::any>* DataStore) override;
+  bool execute(DataStore* store) override;
   void finalize() override {};
 
  private:
 
   TObjArray* _outputList = nullptr;
   Double_t _electron_mass = 0.0;
+  Double_t _fEM_min = 0.0;
   std::map<std::string, std::string> _params;
+
+  CaloAssociation *_calo = nullptr;
+  DataStore::Handle<TObjArray> _inputHandle;
+  DataStore::Handle<EMFractionMap> _emfracHandle;
+  DataStore::Handle<TObjArray> _outputHandle;
 };
 
 #endif
@@ -0,0 +1,287 @@
+#ifndef EVENTSOA_HH
+#define EVENTSOA_HH
+
+/**
+   Structure-of-arrays view of a candidate list (Track, EFlowTrack, Jet,
+   EFlowPhoton, EFlowNeutralHadron, ...): contiguous float columns of the
+   kinematics, impact parameters and charge of every candidate, filled once
+   per event on the first request. Kernels that loop over a whole list
+   (impact-parameter significances, E - pz sums) work on the columns
+   directly instead of building a TLorentzVector per candidate. The
+   significance loop is vectorized in the default build; the E - pz sums
+   are double-precision reductions, which the compiler keeps in order.
+
+   Modules get the shared view of a list in their initialize() with
+   EventSoA::get(store, list, requester, leaves); it is kept in the
+   DataStore under "EventSoA:<list>". The overloads of the AnalysisFunctions
+   helpers at the end of this file take a view and a position in it.
+ **/
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cmath>
+
+#include "TObject.h"
+#include "TObjArray.h"
+#include "TMath.h"
+
+#include "classes/DelphesClasses.h"
+#include "DataStore.h"
+#include "AnalysisFunctions.cc"
+
+class EventSoA {
+  friend class DataStore;
+
+public:
+
+  // Columns of one list, in list order. Impact parameters and the
+  // displacement (D0, DZ, errors, Xd, Yd, Zd) are only filled for tracks
+  // and are 0 otherwise. Columns of leaves that no module declared are not
+  // read from the file and must not be used.
+  struct Columns {
+    Int_t                   size = 0;
+    std::vector<Float_t>    PT;
+    std::vector<Float_t>    Eta;
+    std::vector<Float_t>    Phi;
+    std::vector<Float_t>    E;
+    std::vector<Float_t>    Px;
+    std::vector<Float_t>    Py;
+    std::vector<Float_t>    Pz;
+    std::vector<Float_t>    D0;
+    std::vector<Float_t>    DZ;
+    std::vector<Float_t>    ErrorD0;
+    std::vector<Float_t>    ErrorDZ;
+    std::vector<Float_t>    Xd;
+    std::vector<Float_t>    Yd;
+    std::vector<Float_t>    Zd;
+    std::vector<Int_t>      Charge;
+    std::vector<TObject *>  objects;
+  };
+
+  static EventSoA* get(DataStore *store, std::string list, std::string requester = "",
+                       std::vector<std::string>leaves = {}) {
+    std::string name = "EventSoA:" + list;
+
+    // Another requester may need more leaves of the list
+    store->find<TObjArray>(list, requester, leaves);
+
+    return store->shared<EventSoA>(name, requester, [&]() { return new EventSoA(store, list, requester, leaves); });
+  }
+
+  const Columns& columns() {
+    if (!_built) build();
+    return _columns;
+  }
+
+private:
+
+  EventSoA(DataStore *store, std::string list, std::string requester, std::vector<std::string>leaves) {
+    _store = store;
+    _input = store->find<TObjArray>(list, requester, leaves);
+  }
+
+  void resize(Int_t n) {
+    Columns& c = _columns;
+
+    c.size = n;
+    for (auto column : { &c.PT, &c.Eta, &c.Phi, &c.E, &c.Px, &c.Py, &c.Pz, &c.D0, &c.DZ,
+                         &c.ErrorD0, &c.ErrorDZ, &c.Xd, &c.Yd, &c.Zd }) {
+      column->assign(n, 0.0);
+    }
+    c.Charge.assign(n, 0);
+    c.objects.assign(n, nullptr);
+  }
+
+  // Momentum columns from PT, Eta, Phi and either the mass or the energy
+  void setMomentum(Int_t i, Double_t pt, Double_t eta, Double_t phi, Double_t mass, Double_t energy = -1.0) {
+    Columns& c  = _columns;
+    Double_t pz = pt * std::sinh(eta);
+
+    c.PT[i]  = pt;
+    c.Eta[i] = eta;
+    c.Phi[i] = phi;
+    c.Px[i]  = pt * std::cos(phi);
+    c.Py[i]  = pt * std::sin(phi);
+    c.Pz[i]  = pz;
+    c.E[i]   = (energy >= 0.0) ? energy : std::sqrt(pt * pt + pz * pz + mass * mass);
+  }
+
+  void build() {
+    TObjArray *list = _store->get(_input);
+    Int_t n = (list != nullptr) ? list->GetEntriesFast() : 0;
+
+    resize(n);
+
+    for (Int_t i = 0; i < n; i++) {
+      TObject *obj  = list->At(i);
+      TClass  *type = obj->IsA();
+
+      _columns.objects[i] = obj;
+
+      if (type == Track::Class()) {
+        auto p = static_cast<Track *>(obj);
+        setMomentum(i, p->PT, p->Eta, p->Phi, p->Mass);
+        _columns.D0[i]      = p->D0;
+        _columns.DZ[i]      = p->DZ;
+        _columns.ErrorD0[i] = p->ErrorD0;
+        _columns.ErrorDZ[i] = p->ErrorDZ;
+        _columns.Xd[i]      = p->Xd;
+        _columns.Yd[i]      = p->Yd;
+        _columns.Zd[i]      = p->Zd;
+        _columns.Charge[i]  = p->Charge;
+      } else if (type == Jet::Class()) {
+        auto p = static_cast<Jet *>(obj);
+        setMomentum(i, p->PT, p->Eta, p->Phi, p->Mass);
+        _columns.Charge[i] = p->Charge;
+      } else if (type == Photon::Class()) {
+        auto p = static_cast<Photon *>(obj);
+        setMomentum(i, p->PT, p->Eta, p->Phi, 0.0, p->E);
+      } else if (type == Tower::Class()) {
+        auto p = static_cast<Tower *>(obj);
+        setMomentum(i, p->ET, p->Eta, p->Phi, 0.0, p->E);
+      } else if (type == Electron::Class()) {
+        auto p = static_cast<Electron *>(obj);
+        setMomentum(i, p->PT, p->Eta, p->Phi, 0.000511);
+        _columns.Charge[i] = p->Charge;
+      } else if (type == Muon::Class()) {
+        auto p = static_cast<Muon *>(obj);
+        setMomentum(i, p->PT, p->Eta, p->Phi, 0.105658);
+        _columns.Charge[i] = p->Charge;
+      }
+    }
+    _built = kTRUE;
+  }
+
+  void reset() {
+    _built = kFALSE;
+  }
+
+  DataStore *_store = nullptr;
+  DataStore::Handle<TObjArray>_input;
+  Columns _columns;
+  Bool_t _built = kFALSE;
+};
+
+//
+// Kernels on whole views
+//
+
+// Unsigned 3D and transverse impact-parameter significances of every track
+inline void IPSignificances(const EventSoA::Columns& tracks, std::vector<Float_t>& ip3d, std::vector<Float_t>& ip2d)
+{
+  ip3d.resize(tracks.size);
+  ip2d.resize(tracks.size);
+
+  for (Int_t i = 0; i < tracks.size; i++) {
+    Float_t s0 = std::fabs(tracks.D0[i]) / std::fabs(tracks.ErrorD0[i]);
+    Float_t sz = std::fabs(tracks.DZ[i]) / std::fabs(tracks.ErrorDZ[i]);
+
+    ip2d[i] = s0;
+    ip3d[i] = std::sqrt(s0 * s0 + sz * sz);
+  }
+}
+
+// Sum of E - pz, and of px and py, over the candidates with |eta| > minAbsEta;
+// candidates with an undefined energy are skipped
+inline Double_t SumEminusPz(const EventSoA::Columns& c, Double_t& px, Double_t& py, Float_t minAbsEta = -1.0)
+{
+  Double_t sum = 0.0;
+
+  px = 0.0;
+  py = 0.0;
+
+  for (Int_t i = 0; i < c.size; i++) {
+    Bool_t use = !std::isnan(c.E[i]) && (std::fabs(c.Eta[i]) > minAbsEta);
+
+    sum += use ? (c.E[i] - c.Pz[i]) : 0.0;
+    px  += use ? c.Px[i] : 0.0;
+    py  += use ? c.Py[i] : 0.0;
+  }
+  return sum;
+}
+
+//
+// Overloads of the AnalysisFunctions helpers for a candidate in a view
+//
+
+inline bool IsTaggingTrack(const EventSoA::Columns& tracks, Int_t i)
+{
+  float d0 = TMath::Abs(tracks.D0[i]);
+  float z0 = TMath::Abs(tracks.DZ[i]);
+
+  // 3D impact parameter not above 3 mm, as for IsTaggingTrack(Track *)
+  return !(TMath::Sqrt(d0 * d0 + z0 * z0) > 3.0);
+}
+
+// Signed 3D impact-parameter significance of track i, from the unsigned
+// significances that IPSignificances() computed for the whole view
+inline float sIP3D(Jet *jet, const EventSoA::Columns& tracks, const std::vector<Float_t>& ip3d, Int_t i,
+                   GenParticle *beamspot = nullptr)
+{
+  float jpx = jet->PT * TMath::Cos(jet->Phi);
+  float jpy = jet->PT * TMath::Sin(jet->Phi);
+  float jpz = jet->PT * TMath::SinH(jet->Eta);
+
+  int sign = (jpx * tracks.Xd[i] + jpy * tracks.Yd[i] + jpz * tracks.Zd[i] > 0.0) ? 1 : -1;
+
+  float sip = sign * ip3d[i];
+
+  if (!IsTaggingTrack(tracks, i) || TMath::IsNaN(sip) || !TMath::Finite(sip)) {
+    sip = -199.0;
+  }
+
+  return sip;
+}
+
+inline Double_t JetCharge(Jet *jet, const EventSoA::Columns& tracks, const std::vector<Int_t>& indices, Double_t kappa = 0.5)
+{
+  Double_t jet_Q = indices.empty() ? -99.0 : 0.0;
+
+  for (auto i : indices) {
+    jet_Q += tracks.Charge[i] * TMath::Power(tracks.PT[i], kappa);
+  }
+  jet_Q /= TMath::Power(jet->PT, kappa);
+
+  return jet_Q;
+}
+
+inline std::map<std::string, float>DISJacquetBlondel(const EventSoA::Columns& tracks,
+                                                     const EventSoA::Columns& photons,
+                                                     const EventSoA::Columns& neutral_hadrons)
+{
+  Double_t px, py, sum_px = 0.0, sum_py = 0.0;
+
+  // Jacquet-Blondel method:
+  float delta_track = SumEminusPz(tracks, px, py);
+
+  sum_px += px;
+  sum_py += py;
+
+  float delta_photon = SumEminusPz(photons, px, py);
+
+  sum_px += px;
+  sum_py += py;
+
+  float delta_neutral = SumEminusPz(neutral_hadrons, px, py);
+
+  sum_px += px;
+  sum_py += py;
+
+  float delta = delta_track + delta_photon + delta_neutral;
+
+  float y_JB   = delta / (2.0 * 10.0);
+  float ptmiss = std::sqrt(sum_px * sum_px + sum_py * sum_py);
+  float Q2_JB  = (ptmiss * ptmiss) / (1.0 - y_JB);
+  float s      = 4.0 * 10.0 * 275.0;
+  float x_JB   = Q2_JB / (s * y_JB);
+
+  std::map<std::string, float> dis_variables;
+  dis_variables["x_JB"]  = x_JB;
+  dis_variables["Q2_JB"] = Q2_JB;
+  dis_variables["y_JB"]  = y_JB;
+
+  return dis_variables;
+}
+
+#endif // ifndef EVENTSOA_HH
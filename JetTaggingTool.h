@@ -5,6 +5,7 @@
 // C++ includes
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <utility>
 #include <iostream>
 #include <iomanip>
@@ -19,13 +20,13 @@
 #include "TObjArray.h"
 #include "TClonesArray.h"
 
-#include "TMVA/Factory.h"
-#include "TMVA/DataLoader.h"
-#include "TMVA/Reader.h"
-#include "TMVA/Tools.h"
-
 // Other includes
 #include "AnalysisFunctions.cc"
+#include "DataStore.h"
+#include "ParticleJoin.h"
+#include "JetTrackAssociation.h"
+#include "MLPEvaluator.h"
+#include "EventSoA.h"
 #include "classes/DelphesClasses.h"
 
 using namespace std;
@@ -91,46 +92,27 @@ struct JetTaggingInfo {
 
 
 class JetTaggingTool {
-  static JetTaggingTool *instance;
+  static thread_local JetTaggingTool *instance;
 
   // Private constructor so that no objects can be created.
   JetTaggingTool(ExRootTreeReader * data) {
-    _jet_tagging_store = std::map < TObject *, JetTaggingInfo > ();
+    _jet_tagging_store = std::unordered_map < TObject *, JetTaggingInfo > ();
     _data              = data;
 
-    // MVA tagger initialization
-    _mva_inputs_float           = std::map < TString, Float_t > ();
-    _mva_reader_charmipxdtagger = new TMVA::Reader("Silent");
-
-    _mva_inputs_float["Jet_FiducialJet_KIN_PT"]  = 0.0;
-    _mva_inputs_float["Jet_FiducialJet_KIN_Eta"] = 0.0;
-    _mva_inputs_float["Jet_FiducialJet_TRU_ID"]  = 0;
-    _mva_inputs_float["Event_MET_ET"]            = 0.0;
-
-    _mva_reader_charmipxdtagger->AddSpectator("Jet_FiducialJet_KIN_PT",  &(_mva_inputs_float["Jet_FiducialJet_KIN_PT"]));
-    _mva_reader_charmipxdtagger->AddSpectator("Jet_FiducialJet_KIN_Eta", &(_mva_inputs_float["Jet_FiducialJet_KIN_Eta"]));
-    _mva_reader_charmipxdtagger->AddSpectator("Jet_FiducialJet_TRU_ID",  &(_mva_inputs_float["Jet_FiducialJet_TRU_ID"]));
-    _mva_reader_charmipxdtagger->AddSpectator("Event_MET_ET",            &(_mva_inputs_float["Event_MET_ET"]));
-
-    _mva_inputs_float["Jet_FiducialJet_TAG_t1_sIP3D"] = -199.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t1_IP2D"]  = -1.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t2_sIP3D"] = -199.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t2_IP2D"]  = -1.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t3_sIP3D"] = -199.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t3_IP2D"]  = -1.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t4_sIP3D"] = -199.;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t4_IP2D"]  = -1.;
-
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t1_sIP3D", &(_mva_inputs_float["Jet_FiducialJet_TAG_t1_sIP3D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t1_IP2D",  &(_mva_inputs_float["Jet_FiducialJet_TAG_t1_IP2D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t2_sIP3D", &(_mva_inputs_float["Jet_FiducialJet_TAG_t2_sIP3D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t2_IP2D",  &(_mva_inputs_float["Jet_FiducialJet_TAG_t2_IP2D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t3_sIP3D", &(_mva_inputs_float["Jet_FiducialJet_TAG_t3_sIP3D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t3_IP2D",  &(_mva_inputs_float["Jet_FiducialJet_TAG_t3_IP2D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t4_sIP3D", &(_mva_inputs_float["Jet_FiducialJet_TAG_t4_sIP3D"]));
-    _mva_reader_charmipxdtagger->AddVariable("Jet_FiducialJet_TAG_t4_IP2D",  &(_mva_inputs_float["Jet_FiducialJet_TAG_t4_IP2D"]));
-
-    _mva_reader_charmipxdtagger->BookMVA("CharmIP3DTagger", "share/TMVAClassification_CharmIPXDTagger.weights.xml");
+    // Inputs of the IP3D tagger network, by variable name
+    const MLPEvaluator& tagger = charmIP3DTagger();
+
+    for (Int_t t = 0; t < 4; t++) {
+      _ip3d_pt_input[t]    = tagger.index(Form("jet_t%d_pt", t + 1));
+      _ip3d_sip3d_input[t] = tagger.index(Form("jet_t%d_sIP3D", t + 1));
+    }
+  }
+
+  // The network is immutable, so one copy is shared by all threads
+  static const MLPEvaluator& charmIP3DTagger() {
+    static const MLPEvaluator tagger("share/TMVAClassification_CharmIP3DTagger.weights.xml");
+
+    return tagger;
   }
 
 public:
@@ -140,22 +122,72 @@ public:
     return instance;
   }
 
-  JetTaggingInfo getJetTaggingInfo(TObject *obj) {
-    if (_jet_tagging_store.find(obj) != _jet_tagging_store.end()) {
-      return _jet_tagging_store[obj];
+  // Resolve the DataStore lists used by the taggers
+  void initialize(DataStore *store) {
+    _beamspot_handle        = store->find < TObjArray > ("BeamSpot", "JetTaggingTool");
+    _chargedkaon_handle     = store->findOptional < TObjArray > ("ChargedKaon");
+    _chargedelectron_handle = store->findOptional < TObjArray > ("ChargedElectron");
+
+    // Matches the kaons and electrons to the flow tracks
+    _eflowtrack_join = ParticleJoin::get(store, "EFlowTrack", "JetTaggingTool");
+
+    // Flow tracks of each jet, shared by all the jet-level computations
+    _jet_tracks     = JetTrackAssociation::get(store, "EFlowTrack", "JetTaggingTool");
+
+    // Leaves of the flow tracks read by the taggers, through the view and
+    // through the Track objects (P4() also reads the mass)
+    _eflowtrack_soa = EventSoA::get(store, "EFlowTrack", "JetTaggingTool",
+                                    { "PT", "Eta", "Phi", "Mass", "Charge", "D0", "DZ", "ErrorD0", "ErrorDZ",
+                                      "Xd", "Yd", "Zd", "Particle" });
+
+    // Tagging results are keyed by jet address, and jets are pooled in the
+    // DataStore, so they must not outlive the event
+    if (_store != store) {
+      store->onEndEvent([this]() { clear(); });
+      _store = store;
+    }
+  }
+
+  // Tagging results of a jet. They are computed on the first request in an
+  // event and shared by every later request until the end of the event.
+  const JetTaggingInfo& getJetTaggingInfo(TObject *obj, DataStore *store) {
+    auto cached = _jet_tagging_store.find(obj);
+
+    if (cached != _jet_tagging_store.end()) {
+      return cached->second;
     }
 
-    JetTaggingInfo blank;
-    return blank;
+    execute(obj, store);
+    return _jet_tagging_store[obj];
   }
 
-  void execute(TObjArray *jets, std::map < std::string, std::any > *DataStore) {
+  // Tag the jets of a list that are not tagged yet, evaluating the tagger
+  // network for all of them in one batch
+  void execute(TObjArray *jets, DataStore *store) {
+    std::vector < Jet * > tagged;
+
     for (Int_t i = 0; i < jets->GetEntries(); i++) {
-      execute(jets->At(i), DataStore);
+      TObject *obj = jets->At(i);
+
+      if (_jet_tagging_store.find(obj) != _jet_tagging_store.end()) continue;
+
+      tag(obj, store);
+      tagged.push_back(static_cast < Jet * > (obj));
     }
+
+    compute_CharmIPXDTagger(tagged);
   }
 
-  void execute(TObject *obj, std::map < std::string, std::any > *DataStore) {
+  void execute(TObject *obj, DataStore *store) {
+    // Already computed in this event
+    if (_jet_tagging_store.find(obj) != _jet_tagging_store.end()) return;
+
+    tag(obj, store);
+    compute_CharmIPXDTagger({ static_cast < Jet * > (obj) });
+  }
+
+  // Everything but the tagger network
+  void tag(TObject *obj, DataStore *store) {
     JetTaggingInfo j = {};
 
     // Set some reasonable defaults for variables that are/may be used in
@@ -177,133 +209,138 @@ public:
     _jet_tagging_store[obj] = j;
 
     auto jet = static_cast < Jet * > (obj);
-    compute_sIP3DTagging(jet, DataStore);
+    compute_sIP3DTagging(jet, store);
 
     // Compute Jet-level variables
-    _jet_tagging_store[jet].jet_charge_05 = JetCharge(jet,
-                                                      std::any_cast < TClonesArray * > ((*DataStore)["EFlowTrack"]),
-                                                      0.5);
+    _jet_tagging_store[jet].jet_charge_05 = JetCharge(jet, _eflowtrack_soa->columns(), _jet_tracks->indices(jet), 0.5);
   }
 
   void clear() {
     _jet_tagging_store.clear();
+    _ip_computed = kFALSE;
   }
 
-  void compute_sIP3DTagging(Jet *jet, std::map < std::string, std::any > *DataStore) {
-    TClonesArray *EFlowTrack = std::any_cast < TClonesArray * > ((*DataStore)["EFlowTrack"]);
+  // IP3D tagger network for a batch of jets, one row of inputs per jet;
+  // tracks missing from a jet enter with PT -1 and sIP3D -199, as in the
+  // training
+  void compute_CharmIPXDTagger(const std::vector < Jet * >& jets) {
+    if (jets.empty()) return;
+
+    const MLPEvaluator& tagger = charmIP3DTagger();
+    const size_t nvars = tagger.variables().size();
+
+    const Double_t JetTaggingInfo::* sip3d[4] = {
+      &JetTaggingInfo::t1_sIP3D, &JetTaggingInfo::t2_sIP3D, &JetTaggingInfo::t3_sIP3D, &JetTaggingInfo::t4_sIP3D
+    };
+    std::vector < Double_t > inputs(jets.size() * nvars, 0.0);
+    std::vector < Double_t > outputs(jets.size(), 0.0);
+
+    for (size_t j = 0; j < jets.size(); j++) {
+      const std::vector < Track * >& jet_tracks = _jet_tracks->tracks(jets[j]);
+      const JetTaggingInfo& info = _jet_tagging_store[jets[j]];
+      Double_t *row = &inputs[j * nvars];
+
+      for (size_t t = 0; t < 4; t++) {
+        row[_ip3d_pt_input[t]]    = (jet_tracks.size() > t) ? jet_tracks[t]->PT : -1.0;
+        row[_ip3d_sip3d_input[t]] = info.*sip3d[t];
+      }
+    }
 
+    tagger.evaluate(inputs.data(), jets.size(), outputs.data());
+
+    for (size_t j = 0; j < jets.size(); j++) {
+      _jet_tagging_store[jets[j]].CharmIPXDTagger = outputs[j];
+    }
+  }
+
+  void compute_sIP3DTagging(Jet *jet, DataStore *store) {
     // retrieve the beam spot
-    TClonesArray *BeamSpot = std::any_cast < TClonesArray * > ((*DataStore)["BeamSpot"]);
+    TObjArray *BeamSpot = store->get(_beamspot_handle);
     GenParticle  *bs       = nullptr;
 
     if (BeamSpot != nullptr) {
       bs = static_cast < GenParticle * > (BeamSpot->At(0));
     }
-    _jet_tagging_store[jet].sIP3DTagged = Tagged_sIP3D(jet, *EFlowTrack, 3.00, 0.25, 2.0, bs);
 
-    // Retrieve information about the leading, subleading, etc. tracks
-    std::vector < Track * > jet_tracks;
+    // Leading, subleading, etc. tracks (sorted by PT)
+    const std::vector < Track * >& jet_tracks = _jet_tracks->tracks(jet);
 
-    for (Int_t t = 0; t < EFlowTrack->GetEntries(); t++) {
-      auto trk = static_cast < Track * > (EFlowTrack->At(t));
+    _jet_tagging_store[jet].sIP3DTagged = Tagged_sIP3D(jet, jet_tracks, 3.00, 0.25, 2.0, bs);
 
-      if (jet->P4().DeltaR(trk->P4()) < 0.5) {
-        jet_tracks.push_back(trk);
-      }
-    }
-    std::sort(jet_tracks.begin(), jet_tracks.end(),
-              [] (auto& lhs, const auto& rhs)
-    {
-      return lhs->PT > rhs->PT;
+    // Their variables come from the column view of the flow tracks, and
+    // their significances are computed for all flow tracks at once
+    const EventSoA::Columns& tracks                = _eflowtrack_soa->columns();
+
+    if (!_ip_computed) {
+      IPSignificances(tracks, _ip3d, _ip2d);
+      _ip_computed = kTRUE;
     }
-              );
+
+    const std::vector < Int_t >& jet_track_indices = _jet_tracks->indices(jet);
 
     if (jet_tracks.size() > 0) {
-      _jet_tagging_store[jet].t1_pt    = jet_tracks[0]->PT;
-      _jet_tagging_store[jet].t1_d0    = jet_tracks[0]->D0;
-      _jet_tagging_store[jet].t1_d0err = jet_tracks[0]->ErrorD0;
-      _jet_tagging_store[jet].t1_z0    = jet_tracks[0]->DZ;
-      _jet_tagging_store[jet].t1_z0err = jet_tracks[0]->ErrorDZ;
-      _jet_tagging_store[jet].t1_sIP3D = sIP3D(jet, jet_tracks[0], bs);
+      _jet_tagging_store[jet].t1_pt    = tracks.PT[jet_track_indices[0]];
+      _jet_tagging_store[jet].t1_d0    = tracks.D0[jet_track_indices[0]];
+      _jet_tagging_store[jet].t1_d0err = tracks.ErrorD0[jet_track_indices[0]];
+      _jet_tagging_store[jet].t1_z0    = tracks.DZ[jet_track_indices[0]];
+      _jet_tagging_store[jet].t1_z0err = tracks.ErrorDZ[jet_track_indices[0]];
+      _jet_tagging_store[jet].t1_sIP3D = sIP3D(jet, tracks, _ip3d, jet_track_indices[0], bs);
 
       if (_jet_tagging_store[jet].t1_sIP3D < -199.) _jet_tagging_store[jet].t1_sIP3D = -199.;
-      _jet_tagging_store[jet].t1_IP3D = IP3D(jet_tracks[0]);
-      _jet_tagging_store[jet].t1_IP2D = IP2D(jet_tracks[0]);
+      _jet_tagging_store[jet].t1_IP3D = _ip3d[jet_track_indices[0]];
+      _jet_tagging_store[jet].t1_IP2D = _ip2d[jet_track_indices[0]];
     }
 
     if (jet_tracks.size() > 1) {
-      _jet_tagging_store[jet].t2_pt    = jet_tracks[1]->PT;
-      _jet_tagging_store[jet].t2_d0    = jet_tracks[1]->D0;
-      _jet_tagging_store[jet].t2_d0err = jet_tracks[1]->ErrorD0;
-      _jet_tagging_store[jet].t2_z0    = jet_tracks[1]->DZ;
-      _jet_tagging_store[jet].t2_z0err = jet_tracks[1]->ErrorDZ;
-      _jet_tagging_store[jet].t2_sIP3D = sIP3D(jet, jet_tracks[1], bs);
+      _jet_tagging_store[jet].t2_pt    = tracks.PT[jet_track_indices[1]];
+      _jet_tagging_store[jet].t2_d0    = tracks.D0[jet_track_indices[1]];
+      _jet_tagging_store[jet].t2_d0err = tracks.ErrorD0[jet_track_indices[1]];
+      _jet_tagging_store[jet].t2_z0    = tracks.DZ[jet_track_indices[1]];
+      _jet_tagging_store[jet].t2_z0err = tracks.ErrorDZ[jet_track_indices[1]];
+      _jet_tagging_store[jet].t2_sIP3D = sIP3D(jet, tracks, _ip3d, jet_track_indices[1], bs);
 
       if (_jet_tagging_store[jet].t2_sIP3D < -199.) _jet_tagging_store[jet].t2_sIP3D = -199.;
-      _jet_tagging_store[jet].t2_IP3D = IP3D(jet_tracks[1]);
-      _jet_tagging_store[jet].t2_IP2D = IP2D(jet_tracks[1]);
+      _jet_tagging_store[jet].t2_IP3D = _ip3d[jet_track_indices[1]];
+      _jet_tagging_store[jet].t2_IP2D = _ip2d[jet_track_indices[1]];
     }
 
     if (jet_tracks.size() > 2) {
-      _jet_tagging_store[jet].t3_pt    = jet_tracks[2]->PT;
-      _jet_tagging_store[jet].t3_d0    = jet_tracks[2]->D0;
-      _jet_tagging_store[jet].t3_d0err = jet_tracks[2]->ErrorD0;
-      _jet_tagging_store[jet].t3_z0    = jet_tracks[2]->DZ;
-      _jet_tagging_store[jet].t3_z0err = jet_tracks[2]->ErrorDZ;
-      _jet_tagging_store[jet].t3_sIP3D = sIP3D(jet, jet_tracks[2], bs);
+      _jet_tagging_store[jet].t3_pt    = tracks.PT[jet_track_indices[2]];
+      _jet_tagging_store[jet].t3_d0    = tracks.D0[jet_track_indices[2]];
+      _jet_tagging_store[jet].t3_d0err = tracks.ErrorD0[jet_track_indices[2]];
+      _jet_tagging_store[jet].t3_z0    = tracks.DZ[jet_track_indices[2]];
+      _jet_tagging_store[jet].t3_z0err = tracks.ErrorDZ[jet_track_indices[2]];
+      _jet_tagging_store[jet].t3_sIP3D = sIP3D(jet, tracks, _ip3d, jet_track_indices[2], bs);
 
       if (_jet_tagging_store[jet].t3_sIP3D < -199.) _jet_tagging_store[jet].t3_sIP3D = -199.;
-      _jet_tagging_store[jet].t3_IP3D = IP3D(jet_tracks[2]);
-      _jet_tagging_store[jet].t3_IP2D = IP2D(jet_tracks[2]);
+      _jet_tagging_store[jet].t3_IP3D = _ip3d[jet_track_indices[2]];
+      _jet_tagging_store[jet].t3_IP2D = _ip2d[jet_track_indices[2]];
     }
 
     if (jet_tracks.size() > 3) {
-      _jet_tagging_store[jet].t4_pt    = jet_tracks[3]->PT;
-      _jet_tagging_store[jet].t4_d0    = jet_tracks[3]->D0;
-      _jet_tagging_store[jet].t4_d0err = jet_tracks[3]->ErrorD0;
-      _jet_tagging_store[jet].t4_z0    = jet_tracks[3]->DZ;
-      _jet_tagging_store[jet].t4_z0err = jet_tracks[3]->ErrorDZ;
-      _jet_tagging_store[jet].t4_sIP3D = sIP3D(jet, jet_tracks[3], bs);
+      _jet_tagging_store[jet].t4_pt    = tracks.PT[jet_track_indices[3]];
+      _jet_tagging_store[jet].t4_d0    = tracks.D0[jet_track_indices[3]];
+      _jet_tagging_store[jet].t4_d0err = tracks.ErrorD0[jet_track_indices[3]];
+      _jet_tagging_store[jet].t4_z0    = tracks.DZ[jet_track_indices[3]];
+      _jet_tagging_store[jet].t4_z0err = tracks.ErrorDZ[jet_track_indices[3]];
+      _jet_tagging_store[jet].t4_sIP3D = sIP3D(jet, tracks, _ip3d, jet_track_indices[3], bs);
 
       if (_jet_tagging_store[jet].t4_sIP3D < -199.) _jet_tagging_store[jet].t4_sIP3D = -199.;
-      _jet_tagging_store[jet].t4_IP3D = IP3D(jet_tracks[3]);
-      _jet_tagging_store[jet].t4_IP2D = IP2D(jet_tracks[3]);
+      _jet_tagging_store[jet].t4_IP3D = _ip3d[jet_track_indices[3]];
+      _jet_tagging_store[jet].t4_IP2D = _ip2d[jet_track_indices[3]];
     }
 
-    // Store MVA tagger information
-    _mva_inputs_float["Jet_FiducialJet_TAG_t1_IP2D"]  = _jet_tagging_store[jet].t1_IP2D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t1_sIP3D"] = _jet_tagging_store[jet].t1_sIP3D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t2_IP2D"]  = _jet_tagging_store[jet].t2_IP2D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t2_sIP3D"] = _jet_tagging_store[jet].t2_sIP3D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t3_IP2D"]  = _jet_tagging_store[jet].t3_IP2D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t3_sIP3D"] = _jet_tagging_store[jet].t3_sIP3D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t4_IP2D"]  = _jet_tagging_store[jet].t4_IP2D;
-    _mva_inputs_float["Jet_FiducialJet_TAG_t4_sIP3D"] = _jet_tagging_store[jet].t4_sIP3D;
-
-    _jet_tagging_store[jet].CharmIPXDTagger = _mva_reader_charmipxdtagger->EvaluateMVA("CharmIP3DTagger");
-
     // Retrieve information about leading, subleading, etc. kaons
-    if (DataStore->find("ChargedKaon") != DataStore->end()) {
-      TObjArray *ChargedKaon = std::any_cast < TObjArray * > ((*DataStore)["ChargedKaon"]);
+    TObjArray *ChargedKaon = store->get(_chargedkaon_handle);
+
+    if (ChargedKaon != nullptr) {
       std::vector < Track * > kaon_tracks;
 
       for (Int_t t = 0; t < ChargedKaon->GetEntries(); t++) {
         auto kaon = static_cast < Track * > (ChargedKaon->At(t));
 
         // Find the matching EFlowTrack inside the jet
-        Track *trk = nullptr;
-
-        for (Int_t e = 0; e < EFlowTrack->GetEntries(); e++) {
-          auto eflowtrack = static_cast < Track * > (EFlowTrack->At(e));
-          auto eflowcand  = static_cast < Candidate * > (EFlowTrack->At(e));
-
-          if (eflowtrack == nullptr) continue;
-
-          if (kaon->Particle.GetObject() == eflowtrack->Particle.GetObject()) {
-            trk = eflowtrack;
-            break;
-          }
-        }
+        Track *trk = _eflowtrack_join->find < Track > (kaon->Particle.GetObject());
 
         if (trk == nullptr) continue;
 
@@ -363,8 +400,9 @@ public:
 
 
     // Retrieve information about leading, subleading, etc. electrons
-    if (DataStore->find("ChargedElectron") != DataStore->end()) {
-      auto ChargedElectron = std::any_cast < TObjArray * > ((*DataStore)["ChargedElectron"]);
+    TObjArray *ChargedElectron = store->get(_chargedelectron_handle);
+
+    if (ChargedElectron != nullptr) {
 
       std::vector < Electron * > electrons;
 
@@ -386,15 +424,12 @@ public:
         _jet_tagging_store[jet].e1_pt = electrons[0]->PT;
         _jet_tagging_store[jet].e1_q = electrons[0]->Charge;
 
-        for (Int_t e = 0; e < EFlowTrack->GetEntries(); e++) {
-          auto eflowtrack = static_cast < Track * > (EFlowTrack->At(e));
+        Track *eflowtrack = _eflowtrack_join->find < Track > (electrons[0]->Particle.GetObject());
 
-          if (eflowtrack->Particle.GetObject() == electrons[0]->Particle.GetObject()) {
-            _jet_tagging_store[jet].e1_sIP3D = sIP3D(jet, eflowtrack, bs);
-	    _jet_tagging_store[jet].e1_IP3D  = IP3D(eflowtrack);
-	    _jet_tagging_store[jet].e1_IP2D  = IP2D(eflowtrack);
-	    break;
-          }
+        if (eflowtrack != nullptr) {
+          _jet_tagging_store[jet].e1_sIP3D = sIP3D(jet, eflowtrack, bs);
+          _jet_tagging_store[jet].e1_IP3D  = IP3D(eflowtrack);
+          _jet_tagging_store[jet].e1_IP2D  = IP2D(eflowtrack);
         }
       } else {
         _jet_tagging_store[jet].e1_pt    = 0.0;
@@ -408,15 +443,12 @@ public:
         _jet_tagging_store[jet].e2_pt = electrons[1]->PT;
         _jet_tagging_store[jet].e2_q = electrons[1]->Charge;
 
-        for (Int_t e = 0; e < EFlowTrack->GetEntries(); e++) {
-          auto eflowtrack = static_cast < Track * > (EFlowTrack->At(e));
+        Track *eflowtrack = _eflowtrack_join->find < Track > (electrons[1]->Particle.GetObject());
 
-          if (eflowtrack->Particle.GetObject() == electrons[1]->Particle.GetObject()) {
-            _jet_tagging_store[jet].e2_sIP3D = sIP3D(jet, eflowtrack, bs);
-	    _jet_tagging_store[jet].e2_IP3D  = IP3D(eflowtrack);
-	    _jet_tagging_store[jet].e2_IP2D  = IP2D(eflowtrack);
-	    break;
-          }
+        if (eflowtrack != nullptr) {
+          _jet_tagging_store[jet].e2_sIP3D = sIP3D(jet, eflowtrack, bs);
+          _jet_tagging_store[jet].e2_IP3D  = IP3D(eflowtrack);
+          _jet_tagging_store[jet].e2_IP2D  = IP2D(eflowtrack);
         }
       } else {
         _jet_tagging_store[jet].e2_pt    = 0.0;
@@ -431,12 +463,24 @@ public:
 private:
 
   ExRootTreeReader *_data = nullptr;
-  std::map < TObject *, JetTaggingInfo > _jet_tagging_store;
-
-  // MVA Taggers
-  std::map < TString, Float_t > _mva_inputs_float;
-
-  TMVA::Reader *_mva_reader_charmipxdtagger;
+  // Per-event results, released by clear() at the end of every event
+  std::unordered_map < TObject *, JetTaggingInfo > _jet_tagging_store;
+
+  DataStore::Handle < TObjArray > _beamspot_handle;
+  DataStore::Handle < TObjArray > _chargedkaon_handle;
+  DataStore::Handle < TObjArray > _chargedelectron_handle;
+  ParticleJoin *_eflowtrack_join = nullptr;
+  JetTrackAssociation *_jet_tracks = nullptr;
+  EventSoA *_eflowtrack_soa = nullptr;
+  // Impact-parameter significances of all flow tracks, filled once per event
+  std::vector<Float_t> _ip3d;
+  std::vector<Float_t> _ip2d;
+  Bool_t _ip_computed = kFALSE;
+  DataStore *_store = nullptr;
+
+  // Positions of the inputs of the IP3D tagger network
+  Int_t _ip3d_pt_input[4];
+  Int_t _ip3d_sip3d_input[4];
 };
 
 #endif /* ifndef JETTAGGINGTOOL_HH */
@@ -0,0 +1,95 @@
+#ifndef JETTRACKASSOCIATION_HH
+#define JETTRACKASSOCIATION_HH
+
+/**
+   Association of the tracks of a list (EFlowTrack, ...) to jets: the
+   tracks within dR < 0.5 of the jet axis, sorted by decreasing PT. The
+   track list is binned once per event in the shared EtaPhiGrid, so each
+   jet only looks at the tracks near its axis, and each jet's tracks are
+   collected once per event on the first request. Every tagging and
+   substructure computation of a jet works from the same list.
+
+   Modules get the shared association of a track list in their
+   initialize() with JetTrackAssociation::get(store, trackList, requester);
+   it is kept in the DataStore under "JetTrackAssociation:<trackList>".
+ **/
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+
+#include "TObject.h"
+#include "TObjArray.h"
+
+#include "classes/DelphesClasses.h"
+#include "DataStore.h"
+#include "DeltaRMatcher.h"
+
+class JetTrackAssociation {
+  friend class DataStore;
+
+public:
+
+  // Tracks of one jet: positions in the track list and the tracks
+  // themselves, both sorted by decreasing PT
+  struct Constituents {
+    std::vector<Int_t>   indices;
+    std::vector<Track *> tracks;
+  };
+
+  static JetTrackAssociation* get(DataStore *store, std::string trackList, std::string requester = "") {
+    std::string name = "JetTrackAssociation:" + trackList;
+
+    return store->shared<JetTrackAssociation>(name, requester, [&]() { return new JetTrackAssociation(store, trackList, requester); });
+  }
+
+  const Constituents& find(Jet *jet) {
+    auto cached = _constituents.find(jet);
+
+    if (cached != _constituents.end()) return cached->second;
+
+    Constituents& constituents = _constituents[jet];
+
+    for (auto found : _grid->within(jet->Eta, jet->Phi, _cone)) {
+      constituents.indices.push_back(found.first);
+    }
+
+    std::sort(constituents.indices.begin(), constituents.indices.end(), [this](Int_t lhs, Int_t rhs) {
+                return track(lhs)->PT > track(rhs)->PT;
+              });
+
+    for (auto index : constituents.indices) constituents.tracks.push_back(track(index));
+
+    return constituents;
+  }
+
+  const std::vector<Track *>& tracks(Jet *jet) {
+    return find(jet).tracks;
+  }
+
+  const std::vector<Int_t>& indices(Jet *jet) {
+    return find(jet).indices;
+  }
+
+private:
+
+  JetTrackAssociation(DataStore *store, std::string trackList, std::string requester) {
+    store->find<TObjArray>(trackList, requester, { "PT" });
+    _grid = EtaPhiGrid::get(store, trackList, requester);
+  }
+
+  Track* track(Int_t index) {
+    return static_cast<Track *>(_grid->at(index));
+  }
+
+  void reset() {
+    _constituents.clear();
+  }
+
+  const Double_t _cone = 0.5;
+  EtaPhiGrid *_grid    = nullptr;
+  std::unordered_map<Jet *, Constituents>_constituents;
+};
+
+#endif // ifndef JETTRACKASSOCIATION_HH
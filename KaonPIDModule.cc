@@ -11,42 +11,39 @@
 KaonPIDModule::KaonPIDModule(ExRootTreeReader *data, std::string name)
   : Module(data, name)
 {
-  _outputList = new TObjArray();
   _kaon_mass  = TDatabasePDG().GetParticle(321)->Mass();
 }
 
 KaonPIDModule::~KaonPIDModule()
 {}
 
-bool KaonPIDModule::execute(std::map<std::string, std::any> *DataStore)
+void KaonPIDModule::initialize()
 {
-  auto data = getData();
-
+  DataStore *store = getDataStore();
+
+  _mRICHHandle      = store->find<TObjArray>("mRICHTrack", getName() + "::KaonPIDModule");
+  _barrelDIRCHandle = store->find<TObjArray>("barrelDIRCTrack", getName() + "::KaonPIDModule");
+  _dualRICHagJoin   = ParticleJoin::get(store, "dualRICHagTrack", getName() + "::KaonPIDModule");
+  _dualRICHcfJoin   = ParticleJoin::get(store, "dualRICHcfTrack", getName() + "::KaonPIDModule");
+  store->find<TObjArray>("dualRICHagTrack", getName() + "::KaonPIDModule", { "PID" });
+  store->find<TObjArray>("dualRICHcfTrack", getName() + "::KaonPIDModule", { "PID" });
+  _trackHandle      = store->find<TObjArray>("Track", getName() + "::KaonPIDModule");
+
+  // Needed to match the dualRICH tracks to the raw tracks
+  store->find<TObjArray>("Particle", getName() + "::KaonPIDModule", { "PID" });
+  _outputHandle     = store->bookList("ChargedKaon", getName() + "::KaonPIDModule");
+  _outputList       = store->get(_outputHandle);
+}
 
-  if (((*DataStore).find("mRICHTrack") == (*DataStore).end()) ||
-      ((*DataStore).find("barrelDIRCTrack") == (*DataStore).end()) ||
-      ((*DataStore).find("dualRICHagTrack") == (*DataStore).end()) ||
-      ((*DataStore).find("dualRICHcfTrack") == (*DataStore).end()) ||
-      ((*DataStore).find("Track") == (*DataStore).end())) {
-    std::stringstream message;
-    message << "Missing track lists from DataStore! [" << getName() << "::KaonPIDModule]" << std::endl;
-    throw std::runtime_error(message.str());
-  }
+bool KaonPIDModule::execute(DataStore *store)
+{
+  auto data = getData();
 
-  auto mRICHTrack      = std::any_cast<TClonesArray *>((*DataStore)["mRICHTrack"]);
-  auto barrelDIRCTrack = std::any_cast<TClonesArray *>((*DataStore)["barrelDIRCTrack"]);
-  auto dualRICHagTrack = std::any_cast<TClonesArray *>((*DataStore)["dualRICHagTrack"]);
-  auto dualRICHcfTrack = std::any_cast<TClonesArray *>((*DataStore)["dualRICHcfTrack"]);
-  auto RawTrack        = std::any_cast<TClonesArray *>((*DataStore)["Track"]);
+  auto mRICHTrack      = store->get(_mRICHHandle);
+  auto barrelDIRCTrack = store->get(_barrelDIRCHandle);
+  auto RawTrack        = store->get(_trackHandle);
 
 
-  if ((_outputList != nullptr) && (_outputList->GetEntries() > 0)) {
-    for (Int_t i = 0; i < _outputList->GetEntries(); i++) {
-      delete _outputList->At(i);
-    }
-    _outputList->Clear();
-  }
-
   if (mRICHTrack != nullptr) {
     for (int itrk = 0; itrk < mRICHTrack->GetEntries(); itrk++) {
       Track *track = (Track *)mRICHTrack->At(itrk);
@@ -56,7 +53,7 @@ bool KaonPIDModule::execute(std::map<std::string, std::any> *DataStore)
       Int_t reco_pid = track->PID;
 
       if (TMath::Abs(reco_pid) == 321) {
-        _outputList->AddLast(newKaon(track));
+        _outputList->AddLast(newKaon(store, track));
       }
     }
   }
@@ -70,7 +67,7 @@ bool KaonPIDModule::execute(std::map<std::string, std::any> *DataStore)
       Int_t reco_pid = track->PID;
 
       if (TMath::Abs(reco_pid) == 321) {
-        _outputList->AddLast(newKaon(track));
+        _outputList->AddLast(newKaon(store, track));
 
       }
     }
@@ -88,48 +85,31 @@ bool KaonPIDModule::execute(std::map<std::string, std::any> *DataStore)
 
       if (p_track < ag_p_threshold) {
         // region of sensitivity for Aerogel
-        if (dualRICHagTrack != nullptr) {
-          for (int itrk = 0; itrk < dualRICHagTrack->GetEntries(); itrk++) {
-            Track *track_ag = (Track *)dualRICHagTrack->At(itrk);
-
-            if (track_ag->Particle.GetObject() == track->Particle.GetObject()) {
-              final_pid = track_ag->PID;
-              break;
-            }
-          }
-        }
+        Track *track_ag = _dualRICHagJoin->find<Track>(track->Particle.GetObject());
+
+        if (track_ag != nullptr) final_pid = track_ag->PID;
       } else {
-        if (dualRICHcfTrack != nullptr) {
-          for (int itrk = 0; itrk < dualRICHcfTrack->GetEntries(); itrk++) {
-            Track *track_cf = (Track *)dualRICHcfTrack->At(itrk);
-
-            if (track_cf->Particle.GetObject() == track->Particle.GetObject()) {
-              final_pid = track_cf->PID;
-              break;
-            }
-          }
-        }
+        Track *track_cf = _dualRICHcfJoin->find<Track>(track->Particle.GetObject());
+
+        if (track_cf != nullptr) final_pid = track_cf->PID;
       }
 
       Track drich_track = *track;
       drich_track.PID = final_pid;
 
       if (TMath::Abs(final_pid) == 321)
-        _outputList->AddLast(newKaon(&drich_track));
+        _outputList->AddLast(newKaon(store, &drich_track));
     }
   }
 
 
-  (*DataStore)["ChargedKaon"] = _outputList;
-
-
   return true;
 }
 
-Track * KaonPIDModule::newKaon(Track *track)
+Track * KaonPIDModule::newKaon(DataStore *store, Track *track)
 {
   if (track != nullptr) {
-    Track *charged_kaon = static_cast<Track *>(track->Clone());
+    Track *charged_kaon = store->create(*track);
     auto   p4           = charged_kaon->P4();
     p4.SetPtEtaPhiM(charged_kaon->PT, charged_kaon->Eta, charged_kaon->Phi, _kaon_mass);
     charged_kaon->PT   = p4.Pt();
@@ -21,6 +21,7 @@
 
 // Other includes
 #include "Module.h"
+#include "ParticleJoin.h"
 #include "AnalysisFunctions.cc"
 #include "classes/DelphesClasses.h"
 
@@ -33,17 +34,24 @@ class KaonPIDModule : public Module {
 
   ~KaonPIDModule();
 
-  void initialize() override {};
-  bool execute(std::map<std::string, std::any>* DataStore) override;
+  void initialize() override;
+  bool execute(DataStore* store) override;
   void finalize() override {};
 
  private:
 
   // Functions
-  Track* newKaon(Track* track);
+  Track* newKaon(DataStore* store, Track* track);
 
   TObjArray* _outputList = nullptr;
   Double_t _kaon_mass;
+
+  DataStore::Handle<TObjArray> _mRICHHandle;
+  DataStore::Handle<TObjArray> _barrelDIRCHandle;
+  ParticleJoin *_dualRICHagJoin = nullptr;
+  ParticleJoin *_dualRICHcfJoin = nullptr;
+  DataStore::Handle<TObjArray> _trackHandle;
+  DataStore::Handle<TObjArray> _outputHandle;
 };
 
 #endif
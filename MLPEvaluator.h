@@ -0,0 +1,265 @@
+#ifndef MLPEVALUATOR_HH
+#define MLPEVALUATOR_HH
+
+/**
+   Evaluation of a TMVA MLP network read from its weights XML file (as in
+   share/), without TMVA::Reader. The file gives the input variables, the
+   Normalize transform (ranges of the last class block, i.e. all classes,
+   which is what the Reader applies), the layer weights and the neuron
+   type; hidden neurons use that activation and, for classification, the
+   output neuron is a sigmoid, as in TMVA.
+
+   An evaluator is immutable once constructed, so one instance can be
+   shared by every thread. evaluate() takes a batch of jets (row-major, one
+   row of inputs per jet) and runs each layer as a matrix product whose
+   inner loop is contiguous in memory; the -O3 build vectorizes it (check
+   with "make vecreport").
+ **/
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <cmath>
+
+#include "TXMLEngine.h"
+#include "TString.h"
+
+class MLPEvaluator {
+public:
+
+  MLPEvaluator(std::string weightfile) {
+    _weightfile = weightfile;
+
+    TXMLEngine xml;
+    XMLDocPointer_t doc = xml.ParseFile(weightfile.c_str());
+
+    if (doc == nullptr) fail("Unable to parse weight file");
+
+    XMLNodePointer_t setup = xml.DocGetRootElement(doc);
+    std::string classification = "Classification";
+
+    for (XMLNodePointer_t node = xml.GetChild(setup); node != nullptr; node = xml.GetNext(node)) {
+      TString name = xml.GetNodeName(node);
+
+      if (name == "GeneralInfo") {
+        for (XMLNodePointer_t info = xml.GetChild(node); info != nullptr; info = xml.GetNext(info)) {
+          if (TString(xml.GetAttr(info, "name")) == "AnalysisType") classification = xml.GetAttr(info, "value");
+        }
+      } else if (name == "Options") {
+        readOptions(xml, node);
+      } else if (name == "Variables") {
+        for (XMLNodePointer_t var = xml.GetChild(node); var != nullptr; var = xml.GetNext(var)) {
+          _variables.push_back(xml.GetAttr(var, "Expression"));
+        }
+      } else if (name == "Transformations") {
+        readTransformations(xml, node);
+      } else if (name == "Weights") {
+        readWeights(xml, xml.GetChild(node));
+      }
+    }
+    xml.FreeDoc(doc);
+
+    _output_activation = (classification == "Regression") ? kLinear : kSigmoid;
+
+    if (_layers.empty()) fail("No network layers");
+    if (_layers.front().n_in != Int_t(_variables.size())) fail("Input layer does not match the variables");
+    if (!_min.empty() && (_min.size() != _variables.size())) fail("Normalize ranges do not match the variables");
+    if (_layers.back().n_out != 1) fail("Only networks with a single output are supported");
+  }
+
+  const std::vector<std::string>& variables() const {
+    return _variables;
+  }
+
+  // Position of an input variable (by its expression in the weight file)
+  Int_t index(std::string variable) const {
+    for (size_t v = 0; v < _variables.size(); v++) {
+      if (_variables[v] == variable) return v;
+    }
+    fail("No input variable " + variable);
+    return -1;
+  }
+
+  // Network output for n rows of inputs, each variables().size() long
+  void evaluate(const Double_t *inputs, Int_t n, Double_t *outputs) const {
+    Int_t nvars = _variables.size();
+    std::vector<Double_t> current(inputs, inputs + n * nvars);
+    std::vector<Double_t> next;
+
+    if (!_min.empty()) {
+      for (Int_t row = 0; row < n; row++) {
+        for (Int_t v = 0; v < nvars; v++) {
+          // Single precision, as in TMVA's VariableNormalizeTransform
+          Float_t value = current[row * nvars + v];
+          current[row * nvars + v] = Float_t(((value - _min[v]) * _scale[v]) * 2 - 1);
+        }
+      }
+    }
+
+    for (size_t l = 0; l < _layers.size(); l++) {
+      const Layer& layer      = _layers[l];
+      Activation   activation = (l + 1 == _layers.size()) ? _output_activation : _hidden_activation;
+
+      next.assign(n * layer.n_out, 0.0);
+
+      for (Int_t row = 0; row < n; row++) {
+        const Double_t *x = &current[row * layer.n_in];
+        Double_t       *y = &next[row * layer.n_out];
+
+        for (Int_t j = 0; j < layer.n_out; j++) y[j] = layer.bias[j];
+
+        for (Int_t i = 0; i < layer.n_in; i++) {
+          const Double_t  xi = x[i];
+          const Double_t *w  = &layer.weights[i * layer.n_out];
+
+          for (Int_t j = 0; j < layer.n_out; j++) y[j] += xi * w[j];
+        }
+
+        for (Int_t j = 0; j < layer.n_out; j++) y[j] = activate(activation, y[j]);
+      }
+      current.swap(next);
+    }
+
+    for (Int_t row = 0; row < n; row++) outputs[row] = current[row];
+  }
+
+  // Network output for a single row of inputs
+  Double_t evaluate(const std::vector<Double_t>& inputs) const {
+    Double_t output = 0.0;
+
+    if (inputs.size() != _variables.size()) fail("Wrong number of inputs");
+
+    evaluate(inputs.data(), 1, &output);
+    return output;
+  }
+
+private:
+
+  enum Activation { kLinear, kSigmoid, kTanh, kReLU };
+
+  // Weights from each input neuron to each output neuron, row-major by
+  // input, and the weights from the bias neuron of the previous layer
+  struct Layer {
+    Int_t                 n_in  = 0;
+    Int_t                 n_out = 0;
+    std::vector<Double_t> weights;
+    std::vector<Double_t> bias;
+  };
+
+  static Double_t activate(Activation activation, Double_t x) {
+    switch (activation) {
+    case kSigmoid:
+      return 1.0 / (1.0 + std::exp(-x));
+
+    case kTanh:
+      return std::tanh(x);
+
+    case kReLU:
+      return (x > 0.0) ? x : 0.0;
+
+    default:
+      return x;
+    }
+  }
+
+  void fail(std::string problem) const {
+    std::stringstream message;
+
+    message << problem << " in " << _weightfile << "! [MLPEvaluator]" << std::endl;
+    throw std::runtime_error(message.str());
+  }
+
+  void readOptions(TXMLEngine& xml, XMLNodePointer_t options) {
+    for (XMLNodePointer_t option = xml.GetChild(options); option != nullptr; option = xml.GetNext(option)) {
+      TString name  = xml.GetAttr(option, "name");
+      TString value = TString(xml.GetNodeContent(option)).Strip(TString::kBoth);
+
+      if (name == "NeuronType") {
+        if (value == "ReLU") _hidden_activation = kReLU;
+        else if (value == "sigmoid") _hidden_activation = kSigmoid;
+        else if (value == "tanh") _hidden_activation = kTanh;
+        else if (value == "linear") _hidden_activation = kLinear;
+        else fail("Unsupported NeuronType " + std::string(value.Data()));
+      } else if ((name == "NeuronInputType") && (value != "sum")) {
+        fail("Unsupported NeuronInputType " + std::string(value.Data()));
+      }
+    }
+  }
+
+  void readTransformations(TXMLEngine& xml, XMLNodePointer_t transformations) {
+    for (XMLNodePointer_t transform = xml.GetChild(transformations); transform != nullptr; transform = xml.GetNext(transform)) {
+      if (TString(xml.GetAttr(transform, "Name")) != "Normalize") {
+        fail("Unsupported transformation " + std::string(xml.GetAttr(transform, "Name")));
+      }
+
+      // The last class block holds the ranges over all classes
+      XMLNodePointer_t ranges = nullptr;
+
+      for (XMLNodePointer_t node = xml.GetChild(transform); node != nullptr; node = xml.GetNext(node)) {
+        if (TString(xml.GetNodeName(node)) == "Class") ranges = xml.GetChild(node);
+      }
+      if (ranges == nullptr) fail("Normalize transform without ranges");
+
+      _min.clear();
+      _scale.clear();
+
+      for (XMLNodePointer_t range = xml.GetChild(ranges); range != nullptr; range = xml.GetNext(range)) {
+        Float_t min = std::stod(xml.GetAttr(range, "Min"));
+        Float_t max = std::stod(xml.GetAttr(range, "Max"));
+
+        _min.push_back(min);
+        _scale.push_back((max > min) ? 1.0 / (max - min) : 0.0);
+      }
+    }
+  }
+
+  void readWeights(TXMLEngine& xml, XMLNodePointer_t layout) {
+    // Neurons of each layer; all but the output layer end with a bias neuron
+    std::vector<std::vector<std::vector<Double_t> > > synapses;
+
+    for (XMLNodePointer_t layer = xml.GetChild(layout); layer != nullptr; layer = xml.GetNext(layer)) {
+      std::vector<std::vector<Double_t> > neurons;
+
+      for (XMLNodePointer_t neuron = xml.GetChild(layer); neuron != nullptr; neuron = xml.GetNext(neuron)) {
+        std::vector<Double_t> weights;
+        std::stringstream     content(xml.GetNodeContent(neuron) ? xml.GetNodeContent(neuron) : "");
+        Double_t weight;
+
+        while (content >> weight) weights.push_back(weight);
+
+        if (Int_t(weights.size()) != xml.GetIntAttr(neuron, "NSynapses")) fail("Wrong number of synapses");
+        neurons.push_back(weights);
+      }
+      synapses.push_back(neurons);
+    }
+
+    for (size_t l = 0; l + 1 < synapses.size(); l++) {
+      Layer layer;
+
+      layer.n_in  = synapses[l].size() - 1;
+      layer.n_out = synapses[l + 1].size() - ((l + 2 < synapses.size()) ? 1 : 0);
+
+      for (auto neuron : synapses[l]) {
+        if (Int_t(neuron.size()) != layer.n_out) fail("Synapses do not match the next layer");
+      }
+
+      for (Int_t i = 0; i < layer.n_in; i++) {
+        layer.weights.insert(layer.weights.end(), synapses[l][i].begin(), synapses[l][i].end());
+      }
+      layer.bias = synapses[l].back();
+
+      _layers.push_back(layer);
+    }
+  }
+
+  std::string _weightfile;
+  std::vector<std::string>_variables;
+  std::vector<Float_t>_min;
+  std::vector<Float_t>_scale;
+  std::vector<Layer>_layers;
+  Activation _hidden_activation = kSigmoid;
+  Activation _output_activation = kSigmoid;
+};
+
+#endif // ifndef MLPEVALUATOR_HH
@@ -14,7 +14,7 @@ void Module::initialize()
 {
 }
 
-bool Module::execute(std::map<std::string, std::any>* DataStore)
+bool Module::execute(DataStore* store)
 {
   return true;
 }
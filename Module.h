@@ -3,7 +3,6 @@
 
 #include <map>
 #include <string>
-#include <any>
 
 #include "TTree.h"
 #include "TClonesArray.h"
@@ -12,6 +11,7 @@
 #include "external/ExRootAnalysis/ExRootConfReader.h"
 
 #include "AnalysisFunctions.cc"
+#include "DataStore.h"
 
 
 class Module {
@@ -23,9 +23,15 @@ class Module {
   ~Module();
 
   virtual void initialize();
-  virtual bool execute(std::map<std::string, std::any>* DataStore);
+  virtual bool execute(DataStore* store);
   virtual void finalize();
 
+  // Event filters (modules whose execute() may return false to reject the
+  // event) return true, once initialized. The input branches needed by the
+  // modules up to the first filter are read before the others, which are
+  // only read for events that pass it.
+  virtual bool isFilter() { return false; }
+
   ExRootTreeReader* getData() { return _data;};
   std::string getName() {
     return _name;
@@ -39,51 +45,27 @@ class Module {
     return _config;
   }
 
-  // Particle Objects
-  void setJets(TClonesArray* jets) { _jets = jets; };
-  void setElectrons(TClonesArray* electrons) { _electrons = electrons; };
-  void setPhotons(TClonesArray* photons) { _photons = photons; };
-  void setNeutralHadrons(TClonesArray* neutralhadrons) { _neutralhadrons = neutralhadrons; };
-  void setMuons(TClonesArray* muons) { _muons = muons; };
-  void setTracks(TClonesArray* tracks) { _tracks = tracks; };
-  void setEFlowTracks(TClonesArray* tracks) { _eflowtracks = tracks; };
-  void setMET(TClonesArray* met) { _met = met; };
-
-  void setGenParticles(TClonesArray* particles) { _genparticles = particles; };
-  void setGenJets(TClonesArray* genjets) { _genjets = genjets; };
-
-  TClonesArray* getJets() { return _jets;};
-  TClonesArray* getElectrons() { return _electrons;};
-  TClonesArray* getPhotons() { return _photons;};
-  TClonesArray* getNeutralHadrons() { return _neutralhadrons;};
-  TClonesArray* getMuons() { return _muons;};
-  TClonesArray* getEFlowTracks() { return _eflowtracks;};
-  TClonesArray* getTracks() { return _tracks;};
-  TClonesArray* getMET() { return _met;};
-  TClonesArray* getGenParticles() { return _genparticles;};
-  TClonesArray* getGenJets() { return _genjets;};
+  // The store must be set before initialize(), where modules book and
+  // find the DataStore entries they use
+  void setDataStore( DataStore* store ) {
+    _store = store;
+  }
+
+  DataStore* getDataStore() {
+    return _store;
+  }
+
+  // Entry number of the event currently being processed
+  void setEntry(Long64_t entry) { _entry = entry; };
+  Long64_t getEntry() { return _entry; };
 
  private:
 
   ExRootTreeReader* _data = nullptr; 
   ExRootConfReader* _config = nullptr;
+  DataStore* _store = nullptr;
   std::string _name = "";
-
-  // Particle Object Array Pointers
-  TClonesArray* _jets = nullptr;
-  TClonesArray* _electrons = nullptr;
-  TClonesArray* _photons = nullptr;
-  TClonesArray* _neutralhadrons = nullptr;
-  TClonesArray* _muons = nullptr;
-  TClonesArray* _tracks = nullptr;
-  TClonesArray* _eflowtracks = nullptr;
-
-  TClonesArray* _met = nullptr;
-
-  TClonesArray* _genparticles = nullptr;
-  TClonesArray* _genjets   = nullptr;
-
-
+  Long64_t _entry = -1;
 
 };
 
@@ -17,7 +17,7 @@
 using namespace std;
 
 class ModuleHandler {
-  static ModuleHandler *instance;
+  static thread_local ModuleHandler *instance;
   std::vector<Module *>module_sequence;
 
   // Private constructor so that no objects can be created.
@@ -2,11 +2,21 @@
 #include <TFile.h>
 #include <TChain.h>
 #include <TTree.h>
+#include <TBranchElement.h>
 #include <TString.h>
 #include <TObjString.h>
+#include <TSystem.h>
+#include <TFileMerger.h>
+#include <TEnv.h>
+#include <TTreeCacheUnzip.h>
+#include <TEntryList.h>
+#include <TKey.h>
+#include <TParameter.h>
 #include "TInterpreter.h"
 
 #include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <stdlib.h>
 #include <iostream>
 #include <stdio.h>
@@ -14,7 +24,12 @@
 #include <glob.h>
 #include <vector>
 #include <map>
-#include <any>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
 
 #include "classes/DelphesClasses.h"
 #include "external/ExRootAnalysis/ExRootTreeReader.h"
@@ -24,16 +39,49 @@
 
 #include "ModuleHandler.h"
 #include "TreeHandler.h"
+#include "DataStore.h"
+#include "ChainIndex.h"
+#include "TimingReport.h"
+#include "CutFlow.h"
 #include "JetTaggingTool.h"
 
 static std::string input_dir   = "";
 static std::string output_file = "";
 static std::string config_file = "";
 static int nevents             = -1;
-
-ModuleHandler  *ModuleHandler::instance  = 0;
-TreeHandler    *TreeHandler::instance    = 0;
-JetTaggingTool *JetTaggingTool::instance = 0;
+static int nthreads            = 1;
+static int njobs               = 1;
+static int readahead           = 0;
+static std::string index_file  = ".oleaa_index";
+static Long64_t first_entry    = 0;
+static Long64_t last_entry     = -1;
+static int shard_index         = 0;
+static int shard_count         = 1;
+static std::string entry_list  = "";
+static Long64_t checkpoint_events  = 0;
+static Double_t checkpoint_minutes = 0.0;
+static bool resume                 = false;
+
+// Input chain entries to process with --entry_list; otherwise the entries
+// are the contiguous range from first_entry. The event loop runs over
+// positions in the selection; see entryAt().
+static std::vector<Long64_t> selected_entries;
+
+// Each event-loop thread owns its own module sequence, output tree and
+// tagging tool, so the singletons are per-thread.
+thread_local ModuleHandler  *ModuleHandler::instance  = 0;
+thread_local TreeHandler    *TreeHandler::instance    = 0;
+thread_local JetTaggingTool *JetTaggingTool::instance = 0;
+
+// Serializes worker setup and teardown (TCL parsing, file opening, tagger
+// weight file parsing, etc.) which are not safe to run concurrently.
+static std::mutex setup_mutex;
+
+// Timing of each event-loop thread, merged for the summary at the end
+static std::vector<TimingReport *> timing_reports;
+
+// Cut flow of each event-loop thread, merged for the summary at the end
+static std::vector<CutFlow *> cut_flows;
 
 // HELPER METHODS
 
@@ -43,7 +91,18 @@ void PrintHelp()
     "--input_dir=<i>:       Directory containing all the ROOT files you want to process\n"
     "--output_file=<o>:     Output ROOT file to store results\n"
     "--config_file=<s>:     The TCL-based configuration file.\n"
-    "--nevents=<n>:         The total number of events to process, starting from the zeroth event in the input.\n"
+    "--nevents=<n>:         The total number of events to process, starting from the first selected event.\n"
+    "--first=<f>:           First entry of the input chain to process (default: 0).\n"
+    "--last=<l>:            Process entries before this one only (default: all).\n"
+    "--shard=<i/N>:         Process only the i-th (from 0) of N shards of equal event count of the selected events.\n"
+    "--entry_list=<file[:name]>: Process only the entries of a TEntryList (the first one in the file if no name is given).\n"
+    "--threads=<t>:         Number of event-loop threads; each processes a contiguous block of events (default: 1).\n"
+    "--jobs=<j>:            Number of worker processes; each processes a contiguous block of events, and their outputs are merged (default: 1).\n"
+    "--index_file=<x>:      Sidecar index of input file entry counts, built once and reused (default: .oleaa_index).\n"
+    "--checkpoint_events=<n>: Save the output tree and the job state every n events (default: 0, never).\n"
+    "--checkpoint_minutes=<m>: Save the output tree and the job state every m minutes (default: 0, never).\n"
+    "--resume:              Continue from the last checkpoint of the output file(s); run with the same options otherwise.\n"
+    "--readahead=<r>:       Size in MB of the input read cache; enables background prefetching and decompression (default: 0, ROOT defaults).\n"
     "--help:                Show this helpful message!\n";
 
   exit(1);
@@ -62,6 +121,673 @@ std::vector<std::string>fileVector(const std::string& pattern) {
   return files;
 }
 
+std::vector<std::string>executionPath(ExRootConfReader *confReader)
+{
+  std::vector<std::string> path;
+  ExRootConfParam param = confReader->GetParam("::ExecutionPath");
+
+  for (Long_t i = 0; i < param.GetSize(); ++i) {
+    path.push_back(param[i].GetString());
+  }
+  return path;
+}
+
+// Build the module sequence for the current thread from the TCL configuration
+void configureModules(ModuleHandler *module_handler, ExRootConfReader *confReader)
+{
+  TString name;
+  const ExRootConfReader::ExRootTaskMap *modules = confReader->GetModules();
+  ExRootConfReader::ExRootTaskMap::const_iterator itModules;
+
+  for (auto module_name : executionPath(confReader))
+  {
+    name      = module_name.c_str();
+    itModules = modules->find(name);
+
+    if (itModules != modules->end())
+    {
+      std::cout << "   Appending module " << itModules->second.Data() << std::endl;
+      std::cout << "              named " << itModules->first.Data() << std::endl;
+      module_handler->addModule(itModules->second.Data(), itModules->first.Data());
+
+      Module *the_module = module_handler->getModule(itModules->first.Data());
+
+      if (the_module == nullptr) {
+        stringstream message;
+        message << "module '" << itModules->first.Data();
+        message << " of type " << itModules->second.Data();
+        message << "' could not be retrieved from the ModuleHandler after its creation.";
+        throw runtime_error(message.str());
+      } else {
+        the_module->setConfiguration(confReader);
+      }
+    }
+    else
+    {
+      stringstream message;
+      message << "module '" << name;
+      message << "' is specified in ExecutionPath but not configured.";
+      throw runtime_error(message.str());
+    }
+  }
+}
+
+// Delphes branches that modules may request from the DataStore
+static const std::vector<std::string> input_branches = {
+  "Jet", "Electron", "EFlowPhoton", "EFlowNeutralHadron", "GenJet", "Particle",
+  "Track", "EFlowTrack", "MissingET", "Tower", "BeamSpot", "Event",
+
+  // PID system branches (lists of particles ID'd using PID systems)
+  "mRICHTrack", "barrelDIRCTrack", "dualRICHagTrack", "dualRICHcfTrack"
+};
+
+// Read only the input branches that some module found in the DataStore and,
+// within those, only the declared leaves. The TObject leaves are always kept
+// so that TRef/TRefArray targets are still registered when they are read.
+// Only the given branches are attached to this reader.
+// Returns the active branches (and whether all their sub-branches are).
+std::vector<std::pair<std::string, bool> > activateBranches(TChain                      *data,
+                                                            ExRootTreeReader            *treeReader,
+                                                            DataStore                   *store,
+                                                            const std::set<std::string>& branches,
+                                                            bool                         verbose)
+{
+  std::vector<std::pair<std::string, bool> > active;
+
+  for (auto branch : input_branches) {
+    if (branches.count(branch) == 0) continue;
+
+    if (!store->isUsed(branch)) {
+      if (verbose) std::cout << "Branch " << branch << " is not used by any module and will not be read" << std::endl;
+      continue;
+    }
+
+    std::set<std::string> leaves = store->getLeaves(branch);
+
+    TObjArray *array = treeReader->UseBranch(branch.c_str());
+    store->put(store->find<TObjArray>(branch, "OLeAA"), array);
+
+    if (array == nullptr) continue;
+
+    if (leaves.empty()) {
+      active.push_back(std::make_pair(branch, true));
+      continue;
+    }
+
+    data->SetBranchStatus(Form("%s.*", branch.c_str()), 0);
+
+    leaves.insert("fUniqueID");
+    leaves.insert("fBits");
+
+    active.push_back(std::make_pair(branch, false));
+
+    for (auto leaf : leaves) {
+      data->SetBranchStatus(Form("%s.%s", branch.c_str(), leaf.c_str()), 1);
+      active.push_back(std::make_pair(Form("%s.%s", branch.c_str(), leaf.c_str()), false));
+    }
+
+    if (verbose) {
+      std::cout << "Branch " << branch << " will be read with leaves:";
+      for (auto leaf : leaves) std::cout << " " << leaf;
+      std::cout << std::endl;
+    }
+  }
+  return active;
+}
+
+// Size the read cache and fill it with exactly the active branches over this
+// thread's entry range, so no learning phase is needed and the cache never
+// reads the baskets of pruned branches. Event deserialization stays on the
+// event-loop thread: the branch arrays are filled in place and TRefs resolve
+// through the current event's object table.
+void configureReadCache(TChain                                          *data,
+                        const std::vector<std::pair<std::string, bool> >& active,
+                        Long64_t                                         first,
+                        Long64_t                                         last)
+{
+  if (readahead <= 0) return;
+
+  data->LoadTree(first);
+  data->SetCacheSize(Long64_t(readahead) * 1024 * 1024);
+  data->SetCacheEntryRange(first, last);
+
+  for (auto branch : active) {
+    data->AddBranchToCache(branch.first.c_str(), branch.second);
+  }
+  data->StopCacheLearningPhase();
+}
+
+// Generator weight of the current event (HepMCEvent or LHEFEvent), or 1 if
+// the input has no weighted event record
+Double_t eventWeight(TObjArray *event)
+{
+  if ((event == nullptr) || (event->GetEntriesFast() == 0)) return 1.0;
+
+  TObject *record = event->At(0);
+
+  if (record->IsA() == HepMCEvent::Class()) return static_cast<HepMCEvent *>(record)->Weight;
+  if (record->IsA() == LHEFEvent::Class()) return static_cast<LHEFEvent *>(record)->Weight;
+
+  return 1.0;
+}
+
+// Input chain entry at a position of the selection
+inline Long64_t entryAt(Long64_t position)
+{
+  return (entry_list == "") ? first_entry + position : selected_entries[position];
+}
+
+// Entries of the TEntryList given as "file.root" or "file.root:name", as
+// entry numbers of the input chain. Sub-lists are matched to the input
+// files by path; a list without a file name holds chain entry numbers.
+std::vector<Long64_t> readEntryList(std::string                     spec,
+                                    const std::vector<std::string>& files,
+                                    const std::vector<Long64_t>&    file_entries)
+{
+  std::string path = spec;
+  std::string name = "";
+  size_t colon     = spec.rfind(':');
+
+  if ((colon != std::string::npos) && (spec.find('/', colon) == std::string::npos)) {
+    path = spec.substr(0, colon);
+    name = spec.substr(colon + 1);
+  }
+
+  TFile *file = TFile::Open(path.c_str());
+
+  if ((file == nullptr) || file->IsZombie()) {
+    stringstream message;
+    message << "unable to open the entry list file '" << path << "'.";
+    throw runtime_error(message.str());
+  }
+
+  TEntryList *list = nullptr;
+
+  if (name != "") {
+    list = file->Get<TEntryList>(name.c_str());
+  } else {
+    TIter next(file->GetListOfKeys());
+
+    while (TKey *key = static_cast<TKey *>(next())) {
+      if (std::string(key->GetClassName()) == "TEntryList") {
+        list = file->Get<TEntryList>(key->GetName());
+        break;
+      }
+    }
+  }
+
+  if (list == nullptr) {
+    stringstream message;
+    message << "no TEntryList " << name << " in '" << path << "'.";
+    throw runtime_error(message.str());
+  }
+
+  // Chain entry of the first entry of each input file
+  std::vector<Long64_t> offsets(1, 0);
+
+  for (auto entries : file_entries) offsets.push_back(offsets.back() + entries);
+
+  auto canonical = [](std::string p) {
+                     std::error_code error;
+                     return std::filesystem::weakly_canonical(p, error).string();
+                   };
+
+  std::vector<TEntryList *> sublists;
+
+  if (list->GetLists() != nullptr) {
+    for (auto sublist : *list->GetLists()) sublists.push_back(static_cast<TEntryList *>(sublist));
+  } else {
+    sublists.push_back(list);
+  }
+
+  std::vector<Long64_t> entries;
+
+  for (auto sublist : sublists) {
+    std::string list_file = sublist->GetFileName();
+    Long64_t    offset    = 0;
+
+    if (list_file != "") {
+      Int_t index = -1;
+
+      for (size_t f = 0; f < files.size(); f++) {
+        if (canonical(files[f]) == canonical(list_file)) index = f;
+      }
+
+      if (index < 0) {
+        stringstream message;
+        message << "the entry list refers to '" << list_file << "', which is not an input file.";
+        throw runtime_error(message.str());
+      }
+      offset = offsets[index];
+    }
+
+    for (Long64_t k = 0; k < sublist->GetN(); k++) {
+      entries.push_back(offset + sublist->GetEntry(k));
+    }
+  }
+
+  file->Close();
+  delete file;
+
+  std::sort(entries.begin(), entries.end());
+  entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+  return entries;
+}
+
+// Record the progress of an event-loop thread in its output file: the
+// positions it was given, the next one to process, the number of entries
+// in the output tree, and the timing and cut flow so far. The tree is then
+// saved (TreeHandler::checkpoint), so the record and the tree on disk agree;
+// --resume continues from such a record.
+void writeCheckpoint(TreeHandler  *tree_handler,
+                     Long64_t      first,
+                     Long64_t      last,
+                     Long64_t      next,
+                     TimingReport *timing,
+                     CutFlow      *cut_flow)
+{
+  TFile *file = tree_handler->getFile();
+
+  timing->writeHistograms(file);
+  cut_flow->writeHistograms(file);
+
+  TDirectory *dir = file->GetDirectory("Checkpoint");
+
+  if (dir == nullptr) dir = file->mkdir("Checkpoint");
+
+  dir->cd();
+  TParameter<Long64_t>("first", first).Write("", TObject::kOverwrite);
+  TParameter<Long64_t>("last", last).Write("", TObject::kOverwrite);
+  TParameter<Long64_t>("next", next).Write("", TObject::kOverwrite);
+  TParameter<Long64_t>("entries", tree_handler->getTree()->GetEntries()).Write("", TObject::kOverwrite);
+  file->cd();
+
+  for (auto name : { "Timing", "CutFlow", "Checkpoint" }) {
+    file->GetDirectory(name)->SaveSelf(kTRUE);
+  }
+
+  tree_handler->checkpoint();
+}
+
+// Position to continue from in a resumed output file, after adding the
+// timing and cut flow recorded at its last checkpoint
+Long64_t readCheckpoint(TreeHandler  *tree_handler,
+                        Long64_t      first,
+                        Long64_t      last,
+                        TimingReport *timing,
+                        CutFlow      *cut_flow)
+{
+  TFile      *file = tree_handler->getFile();
+  TDirectory *dir  = file->GetDirectory("Checkpoint");
+
+  auto parameter = [dir](const char *name) {
+                     TParameter<Long64_t> *p = (dir != nullptr) ? dir->Get<TParameter<Long64_t> >(name) : nullptr;
+                     return (p != nullptr) ? p->GetVal() : Long64_t(-1);
+                   };
+
+  if ((parameter("first") != first) || (parameter("last") != last)) {
+    stringstream message;
+    message << "'" << file->GetName() << "' has no checkpoint for events " << first << " to " << last
+            << "; resume with the same input and options as the original job.";
+    throw runtime_error(message.str());
+  }
+
+  if (parameter("entries") != tree_handler->getTree()->GetEntries()) {
+    stringstream message;
+    message << "the tree in '" << file->GetName() << "' does not match its last checkpoint.";
+    throw runtime_error(message.str());
+  }
+
+  timing->readHistograms(file);
+  cut_flow->readHistograms(file);
+
+  return parameter("next");
+}
+
+// Run the full module sequence over positions [first, last) of the
+// selected entries (see entryAt()), writing the output tree to the given
+// file. This is the body of each event-loop thread.
+void processEntries(const std::vector<std::string>& files,
+                    const std::vector<Long64_t>&    file_entries,
+                    ExRootConfReader               *confReader,
+                    Long64_t                        first,
+                    Long64_t                        last,
+                    std::string                     output)
+{
+  TChain *data                 = nullptr;
+  ExRootTreeReader *treeReader = nullptr;
+  ExRootTreeReader *filter_reader = nullptr;
+  ModuleHandler *module_handler = nullptr;
+  TreeHandler *tree_handler     = nullptr;
+  DataStore *store              = new DataStore();
+  TimingReport *timing          = new TimingReport();
+  CutFlow *cut_flow             = new CutFlow();
+  DataStore::Handle<TObjArray> event_handle;
+  std::vector<Int_t> module_steps;
+  size_t n_filter_modules       = 0;
+  std::vector<Int_t> module_stages;
+  Int_t read_stage              = -1;
+  Int_t fill_stage              = -1;
+  Int_t deferred_stage          = -1;
+  Int_t checkpoint_stage        = -1;
+  Long64_t next                 = first;
+  bool checkpointing            = (checkpoint_events > 0) || (checkpoint_minutes > 0.0) || resume;
+
+  {
+    std::lock_guard<std::mutex> lock(setup_mutex);
+
+    // Prepare the data input
+    data = new TChain("Delphes");
+
+    // The entry counts are known, so no file is opened here
+    for (size_t f = 0; f < files.size(); f++)
+    {
+      data->Add(files[f].c_str(), file_entries[f]);
+    }
+
+    treeReader = new ExRootTreeReader(data);
+
+
+    // Setup the ModuleHandler
+    module_handler = module_handler->getInstance(treeReader);
+    configureModules(module_handler, confReader);
+
+
+    // Register the input branches, with the class of their objects (this
+    // opens the first file). Nothing is read yet: the modules declare what
+    // they need while they initialize.
+    for (auto branch : input_branches) {
+      store->book<TObjArray>(branch, "OLeAA");
+
+      TBranchElement *element = dynamic_cast<TBranchElement *>(data->GetBranch(branch.c_str()));
+
+      if (element != nullptr) store->setClassName(branch, element->GetClonesName());
+    }
+
+
+    // Setup the output storage
+    tree_handler = tree_handler->getInstance(output.c_str(), "tree");
+    tree_handler->configure(confReader);
+    tree_handler->initialize(resume);
+
+    // Only checkpoints save the tree, so that it always matches the record
+    if (checkpointing) tree_handler->getTree()->SetAutoSave(0);
+
+    // The event weight, for the weighted cut flow
+    event_handle = store->find<TObjArray>("Event", "OLeAA", { "Weight" });
+
+    // The branches used by the modules up to the first event filter are
+    // read first; the others are only read for events that pass it
+    std::set<std::string> all_branches(input_branches.begin(), input_branches.end());
+    std::set<std::string> filter_branches;
+    auto modules = module_handler->getModules();
+
+    for (size_t m = 0; m < modules.size(); m++) {
+      modules[m]->setDataStore(store);
+      modules[m]->initialize();
+
+      if ((n_filter_modules == 0) && modules[m]->isFilter()) {
+        n_filter_modules = m + 1;
+
+        for (auto branch : input_branches) {
+          if (store->isUsed(branch)) filter_branches.insert(branch);
+        }
+      }
+    }
+
+    // Load object pointers for the declared inputs only. The branch arrays
+    // are filled in place on every ReadEntry, so they are put in the
+    // DataStore only once.
+    std::vector<std::pair<std::string, bool> > active;
+
+    if (n_filter_modules > 0) {
+      std::set<std::string> deferred_branches;
+
+      for (auto branch : input_branches) {
+        if (filter_branches.count(branch) == 0) deferred_branches.insert(branch);
+      }
+
+      if (first == 0) {
+        std::cout << "Branches read before " << modules[n_filter_modules - 1]->getName() << ":";
+        for (auto branch : filter_branches) std::cout << " " << branch;
+        std::cout << std::endl;
+      }
+
+      filter_reader = new ExRootTreeReader(data);
+      active        = activateBranches(data, filter_reader, store, filter_branches, first == 0);
+
+      auto deferred = activateBranches(data, treeReader, store, deferred_branches, first == 0);
+      active.insert(active.end(), deferred.begin(), deferred.end());
+    } else {
+      active = activateBranches(data, treeReader, store, all_branches, first == 0);
+    }
+
+    read_stage = timing->addStage("ReadEntry");
+    if (filter_reader != nullptr) deferred_stage = timing->addStage("ReadEntry:deferred");
+    for (auto module : module_handler->getModules()) {
+      module_stages.push_back(timing->addStage(module->getName()));
+    }
+    fill_stage = timing->addStage("TreeHandler::execute");
+
+    if (checkpointing) checkpoint_stage = timing->addStage("Checkpoint");
+
+    for (auto module : module_handler->getModules()) {
+      module_steps.push_back(cut_flow->addStep(module->getName()));
+    }
+
+    if (tree_handler->resumed()) {
+      next = readCheckpoint(tree_handler, first, last, timing, cut_flow);
+      std::cout << "Resuming " << output << " at event " << next - first << " of " << last - first << std::endl;
+    }
+
+    if (next < last) configureReadCache(data, active, entryAt(next), entryAt(last - 1) + 1);
+  }
+
+  auto last_checkpoint = std::chrono::steady_clock::now();
+
+  for (Long64_t p = next; p < last; ++p) {
+    Long64_t i = entryAt(p);
+
+    // event number printout
+    if (p % 1000 == 0) {
+      std::cout << "Processing Event " << i << std::endl;
+    }
+
+    timing->mark();
+
+    // read the data for i-th event
+    // data->GetEntry(i);
+    // Load selected branches with data from specified event
+    if (filter_reader != nullptr) {
+      filter_reader->ReadEntry(i);
+    } else {
+      treeReader->ReadEntry(i);
+    }
+    timing->lap(read_stage);
+
+    Double_t weight = eventWeight(store->get(event_handle));
+
+    cut_flow->pass(0, weight);
+
+    // A module returning false rejects the event: the rest of the sequence
+    // is skipped and nothing is written for it
+    auto modules  = module_handler->getModules();
+    bool accepted = true;
+
+    for (size_t m = 0; m < modules.size(); m++) {
+      // The event passed the first filter: read the remaining branches
+      if ((filter_reader != nullptr) && (m == n_filter_modules)) {
+        treeReader->ReadEntry(i);
+        timing->lap(deferred_stage);
+      }
+
+      modules[m]->setEntry(i);
+
+      accepted = modules[m]->execute(store);
+
+      timing->lap(module_stages[m]);
+
+      if (accepted == false) break;
+
+      cut_flow->pass(module_steps[m], weight);
+    }
+
+    if (accepted) {
+      tree_handler->execute();
+      timing->lap(fill_stage);
+    }
+
+    // Release the lists and candidates made during this event
+    store->endEvent();
+
+    if (checkpointing) {
+      auto now = std::chrono::steady_clock::now();
+      bool due = (checkpoint_events > 0) && ((p + 1 - next) % checkpoint_events == 0);
+
+      due = due || ((checkpoint_minutes > 0.0) &&
+                    (std::chrono::duration<Double_t>(now - last_checkpoint).count() >= 60.0 * checkpoint_minutes));
+
+      if (due && (p + 1 < last)) {
+        timing->mark();
+        writeCheckpoint(tree_handler, first, last, p + 1, timing, cut_flow);
+        timing->lap(checkpoint_stage);
+        last_checkpoint = now;
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(setup_mutex);
+
+    for (auto module : module_handler->getModules()) {
+      module->finalize();
+    }
+    if ((tree_handler->getFile() != nullptr) && checkpointing) {
+      writeCheckpoint(tree_handler, first, last, last, timing, cut_flow);
+    } else if (tree_handler->getFile() != nullptr) {
+      timing->writeHistograms(tree_handler->getFile());
+      cut_flow->writeHistograms(tree_handler->getFile());
+    }
+    tree_handler->finalize();
+
+    timing_reports.push_back(timing);
+    cut_flows.push_back(cut_flow);
+  }
+}
+
+// Concatenate the per-thread output files, in order, into the final output
+void mergeOutputs(const std::vector<std::string>& parts, std::string output)
+{
+  std::cout << "Merging " << parts.size() << " partial outputs into " << output << std::endl;
+
+  TFileMerger merger(kFALSE);
+  merger.OutputFile(output.c_str(), "RECREATE");
+
+  for (auto part : parts) {
+    merger.AddFile(part.c_str(), kFALSE);
+  }
+
+  // The checkpoint records only describe the partial outputs
+  merger.AddObjectNames("Checkpoint");
+
+  if (!merger.PartialMerge(TFileMerger::kAll | TFileMerger::kRegular | TFileMerger::kSkipListed)) {
+    stringstream message;
+    message << "failed to merge the partial outputs into '" << output << "'.";
+    throw runtime_error(message.str());
+  }
+
+  for (auto part : parts) {
+    gSystem->Unlink(part.c_str());
+  }
+}
+
+// Read the timing and cut flow written to an output file back into the
+// summaries of the job
+void readSummaries(std::string output)
+{
+  TFile *file = TFile::Open(output.c_str());
+
+  if ((file == nullptr) || file->IsZombie()) {
+    stringstream message;
+    message << "unable to open the output '" << output << "'.";
+    throw runtime_error(message.str());
+  }
+
+  TimingReport *timing = new TimingReport();
+  CutFlow *cut_flow    = new CutFlow();
+
+  timing->readHistograms(file);
+  cut_flow->readHistograms(file);
+  timing_reports.push_back(timing);
+  cut_flows.push_back(cut_flow);
+
+  file->Close();
+  delete file;
+}
+
+// With --resume, an output that exists while none of its n partial outputs
+// (output + suffix, e.g. ".part%d") do was merged already: it is complete
+bool alreadyMerged(std::string output, const char *suffix, int n)
+{
+  if (!resume || gSystem->AccessPathName(output.c_str())) return false;
+
+  for (int i = 0; i < n; i++) {
+    if (!gSystem->AccessPathName((output + Form(suffix, i)).c_str())) return false;
+  }
+
+  std::cout << output << " is complete; nothing to resume" << std::endl;
+  return true;
+}
+
+// Run entries [first, last) on nthreads event-loop threads, each taking a
+// contiguous block of entries and writing its own output; the blocks are
+// merged back in entry order afterward.
+void processRange(const std::vector<std::string>& files,
+                  const std::vector<Long64_t>&    file_entries,
+                  ExRootConfReader               *confReader,
+                  Long64_t                        first,
+                  Long64_t                        last,
+                  std::string                     output)
+{
+  // Started here rather than in main(), so that worker processes are
+  // forked before the ROOT thread pool exists. It is used to decompress the
+  // input and, with OutputImplicitMT, to compress the output.
+  if ((readahead > 0) || confReader->GetBool("::OutputImplicitMT", kFALSE)) ROOT::EnableImplicitMT();
+
+  Long64_t n_process = last - first;
+  int      n_threads = std::min(Long64_t(nthreads), std::max(Long64_t(1), n_process));
+
+  if (n_threads == 1) {
+    processEntries(files, file_entries, confReader, first, last, output);
+    return;
+  }
+
+  if (alreadyMerged(output, ".part%d", n_threads)) {
+    readSummaries(output);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  std::vector<std::string> parts;
+
+  for (int t = 0; t < n_threads; t++) {
+    Long64_t thread_first = first + n_process * t / n_threads;
+    Long64_t thread_last  = first + n_process * (t + 1) / n_threads;
+    std::string part      = output + Form(".part%d", t);
+
+    parts.push_back(part);
+    workers.push_back(std::thread(processEntries, std::cref(files), std::cref(file_entries), confReader,
+                                  thread_first, thread_last, part));
+  }
+
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  mergeOutputs(parts, output);
+}
+
 // MAIN FUNCTION
 
 
@@ -79,12 +805,23 @@ int main(int argc, char *argv[])
     PrintHelp();
   }
 
-  const char *const short_opts = "i:o:c:n:h";
+  const char *const short_opts = "i:o:c:n:f:l:s:e:t:j:E:M:Rr:x:h";
   const option long_opts[]     = {
     { "input_dir",   required_argument,     nullptr,           'i'                 },
     { "output_file", required_argument,     nullptr,           'o'                 },
     { "config_file", required_argument,     nullptr,           'c'                 },
     { "nevents",     optional_argument,     nullptr,           'n'                 },
+    { "first",       required_argument,     nullptr,           'f'                 },
+    { "last",        required_argument,     nullptr,           'l'                 },
+    { "shard",       required_argument,     nullptr,           's'                 },
+    { "entry_list",  required_argument,     nullptr,           'e'                 },
+    { "threads",     required_argument,     nullptr,           't'                 },
+    { "jobs",        required_argument,     nullptr,           'j'                 },
+    { "checkpoint_events",  required_argument, nullptr,         'E'                 },
+    { "checkpoint_minutes", required_argument, nullptr,         'M'                 },
+    { "resume",      no_argument,           nullptr,           'R'                 },
+    { "readahead",   required_argument,     nullptr,           'r'                 },
+    { "index_file",  required_argument,     nullptr,           'x'                 },
     { "help",        no_argument,           nullptr,           'h'                 },
     { nullptr,       no_argument,           nullptr,                             0 }
   };
@@ -118,6 +855,65 @@ int main(int argc, char *argv[])
         std::cout << "Number of events to process: " << nevents << std::endl;
         break;
 
+      case 'f':
+        first_entry = std::stoll(optarg);
+        std::cout << "First entry: " << first_entry << std::endl;
+        break;
+
+      case 'l':
+        last_entry = std::stoll(optarg);
+        std::cout << "Last entry (excluded): " << last_entry << std::endl;
+        break;
+
+      case 's':
+        if ((sscanf(optarg, "%d/%d", &shard_index, &shard_count) != 2) ||
+            (shard_count < 1) || (shard_index < 0) || (shard_index >= shard_count)) {
+          std::cout << "Invalid shard " << optarg << ", expected i/N with 0 <= i < N" << std::endl;
+          PrintHelp();
+        }
+        std::cout << "Shard: " << shard_index << " of " << shard_count << std::endl;
+        break;
+
+      case 'e':
+        entry_list = optarg;
+        std::cout << "Entry list: " << entry_list << std::endl;
+        break;
+
+      case 't':
+        nthreads = std::stoi(optarg);
+        std::cout << "Number of event-loop threads: " << nthreads << std::endl;
+        break;
+
+      case 'j':
+        njobs = std::stoi(optarg);
+        std::cout << "Number of worker processes: " << njobs << std::endl;
+        break;
+
+      case 'E':
+        checkpoint_events = std::stoll(optarg);
+        std::cout << "Checkpoint every " << checkpoint_events << " events" << std::endl;
+        break;
+
+      case 'M':
+        checkpoint_minutes = std::stod(optarg);
+        std::cout << "Checkpoint every " << checkpoint_minutes << " minutes" << std::endl;
+        break;
+
+      case 'R':
+        resume = true;
+        std::cout << "Resuming from the last checkpoint" << std::endl;
+        break;
+
+      case 'r':
+        readahead = std::stoi(optarg);
+        std::cout << "Read cache size (MB): " << readahead << std::endl;
+        break;
+
+      case 'x':
+        index_file = optarg;
+        std::cout << "Input file index: " << index_file << std::endl;
+        break;
+
 
       case 'h': // -h or --help
       case '?': // Unrecognized option
@@ -129,20 +925,40 @@ int main(int argc, char *argv[])
     }
   }
 
+  if ((nthreads < 1) || (njobs < 1)) {
+    PrintHelp();
+  }
+
+  if (nthreads > 1) {
+    ROOT::EnableThreadSafety();
+  }
+
+  if (readahead > 0) {
+    // Fetch the next cluster of baskets on a background thread, and
+    // decompress the cached baskets in parallel, while the modules run.
+    // Both must be set before any input file is opened.
+    gEnv->SetValue("TFile.AsyncPrefetching", 1);
+    TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kEnable);
+  }
 
-  // Prepare the data input
-  auto data = new TChain("Delphes");
 
+  // Prepare the data input. Entry counts come from the index, so only new
+  // or modified files are opened here.
   auto files = fileVector(input_dir);
 
+  ChainIndex chain_index(index_file);
+  chain_index.load();
+
+  std::vector<Long64_t> file_entries;
+  Long64_t n_entries = 0;
+
   for (auto file : files)
   {
-    data->Add(file.c_str());
+    file_entries.push_back(chain_index.entries(file));
+    n_entries += file_entries.back();
   }
 
-  ExRootTreeReader *treeReader = new ExRootTreeReader(data);
-
-  int n_entries = data->GetEntries();
+  chain_index.save();
 
   std::cout
     << "The provided data set contains the following number of events: " << std::endl
@@ -150,165 +966,131 @@ int main(int argc, char *argv[])
     << std::endl;
 
 
-  // Setup the ModuleHandler
-  ModuleHandler *module_handler = module_handler->getInstance(treeReader);
-
-
   // Read the connfiguration information from a TCL file
   ExRootConfReader *confReader = new ExRootConfReader();
   confReader->ReadFile(config_file.c_str());
   confReader->SetName("OLeAAConfReader");
 
-  TString name;
-  ExRootTask *task;
-  const ExRootConfReader::ExRootTaskMap *modules = confReader->GetModules();
-  ExRootConfReader::ExRootTaskMap::const_iterator itModules;
 
-  ExRootConfParam param = confReader->GetParam("::ExecutionPath");
-  Long_t i, size = param.GetSize();
+  // Select the entries to process: those in [first, last) of the chain (and
+  // in the entry list, if given), at most nevents of them, and of those the
+  // requested shard. Shards have equal event counts and cross file
+  // boundaries.
+  if ((last_entry < 0) || (last_entry > n_entries)) last_entry = n_entries;
+  first_entry = std::min(std::max(first_entry, Long64_t(0)), last_entry);
 
-  for (i = 0; i < size; ++i)
-  {
-    name      = param[i].GetString();
-    itModules = modules->find(name);
+  if (entry_list != "") {
+    for (auto entry : readEntryList(entry_list, files, file_entries)) {
+      if ((entry >= first_entry) && (entry < last_entry)) selected_entries.push_back(entry);
+    }
+  }
 
-    if (itModules != modules->end())
-    {
-      std::cout << "   Appending module " << itModules->second.Data() << std::endl;
-      std::cout << "              named " << itModules->first.Data() << std::endl;
-      module_handler->addModule(itModules->second.Data(), itModules->first.Data());
+  Long64_t n_selected = (entry_list != "") ? Long64_t(selected_entries.size()) : last_entry - first_entry;
 
-      Module *the_module = module_handler->getModule(itModules->first.Data());
+  if ((nevents >= 0) && (nevents < n_selected)) n_selected = nevents;
 
-      if (the_module == nullptr) {
-        stringstream message;
-        message << "module '" << itModules->first.Data();
-        message << " of type " << itModules->second.Data();
-        message << "' could not be retrieved from the ModuleHandler after its creation.";
-        throw runtime_error(message.str());
-      } else {
-        the_module->setConfiguration(confReader);
-      }
+  Long64_t shard_first = n_selected * shard_index / shard_count;
+  Long64_t shard_last  = n_selected * (shard_index + 1) / shard_count;
+  Long64_t n_process   = shard_last - shard_first;
 
-      // module_handler->getModule(itModules->first.Data())->setConfiguration(confReader);
-    }
-    else
-    {
-      stringstream message;
-      message << "module '" << name;
-      message << "' is specified in ExecutionPath but not configured.";
-      throw runtime_error(message.str());
-    }
+  if (entry_list != "") {
+    selected_entries = std::vector<Long64_t>(selected_entries.begin() + shard_first,
+                                             selected_entries.begin() + shard_last);
+  } else {
+    first_entry += shard_first;
   }
 
+  std::cout << "Processing " << n_process << " events";
+  if ((entry_list == "") && (n_process > 0)) {
+    std::cout << " (entries " << first_entry << " to " << first_entry + n_process - 1 << ")";
+  } else if (n_process > 0) {
+    std::cout << " of the entry list (entries " << selected_entries.front() << " to " << selected_entries.back() << ")";
+  }
+  std::cout << "..." << std::endl;
 
-  // Load object pointers
-  std::map<TString, TClonesArray *> branchPointer;
-  branchPointer["Jet"]                = treeReader->UseBranch("Jet");
-  branchPointer["Electron"]           = treeReader->UseBranch("Electron");
-  branchPointer["EFlowPhoton"]        = treeReader->UseBranch("EFlowPhoton");
-  branchPointer["EFlowNeutralHadron"] = treeReader->UseBranch("EFlowNeutralHadron");
-  branchPointer["GenJet"]             = treeReader->UseBranch("GenJet");
-  branchPointer["Particle"]           = treeReader->UseBranch("Particle");
-  branchPointer["Track"]              = treeReader->UseBranch("Track");
-  branchPointer["EFlowTrack"]         = treeReader->UseBranch("EFlowTrack");
-  branchPointer["MissingET"]          = treeReader->UseBranch("MissingET");
-  branchPointer["Tower"]              = treeReader->UseBranch("Tower");
-  branchPointer["BeamSpot"]           = treeReader->UseBranch("BeamSpot");
+  if (njobs > n_process) njobs = std::max(Long64_t(1), n_process);
 
-  branchPointer["mRICHTrack"]      = treeReader->UseBranch("mRICHTrack");
-  branchPointer["barrelDIRCTrack"] = treeReader->UseBranch("barrelDIRCTrack");
-  branchPointer["dualRICHagTrack"] = treeReader->UseBranch("dualRICHagTrack");
-  branchPointer["dualRICHcfTrack"] = treeReader->UseBranch("dualRICHcfTrack");
+  auto start = std::chrono::steady_clock::now();
 
+  if (njobs == 1) {
+    processRange(files, file_entries, confReader, 0, n_process, output_file);
+  } else if (alreadyMerged(output_file, ".job%d", njobs)) {
+    readSummaries(output_file);
+  } else {
+    // Each worker process takes a contiguous block of entries and writes its
+    // own output. The timing and cut flow of each worker are read back from
+    // its output, then the outputs are merged in entry order.
+    std::vector<pid_t> children;
+    std::vector<std::string> parts;
 
-  // Setup the output storage
-  TreeHandler *tree_handler = tree_handler->getInstance(output_file.c_str(), "tree");
-  tree_handler->initialize();
+    for (int j = 0; j < njobs; j++) {
+      Long64_t first = n_process * j / njobs;
+      Long64_t last  = n_process * (j + 1) / njobs;
+      std::string part = output_file + Form(".job%d", j);
 
-  for (auto module : module_handler->getModules()) {
-    module->initialize();
-  }
+      parts.push_back(part);
 
-  if (nevents < 0) {
-    std::cout
-      << "Processing all events in the sample..." << std::endl;
-  } else {
-    std::cout
-      << "Processing " << nevents << " events in the sample..." << std::endl;
-  }
+      std::cout.flush();
+      pid_t pid = fork();
 
-  for (int i = 0; i < n_entries; ++i) {
-    // event number printout
-    if (i % 1000 == 0) {
-      std::cout << "Processing Event " << i << std::endl;
+      if (pid < 0) {
+        stringstream message;
+        message << "unable to start worker process " << j << ".";
+        throw runtime_error(message.str());
+      }
+
+      if (pid == 0) {
+        int status = EXIT_SUCCESS;
+
+        try {
+          processRange(files, file_entries, confReader, first, last, part);
+        } catch (std::exception& e) {
+          std::cerr << "Worker process " << j << ": " << e.what() << std::endl;
+          status = EXIT_FAILURE;
+        }
+        std::cout.flush();
+        _exit(status);
+      }
+
+      children.push_back(pid);
     }
 
-    if ((nevents >= 0) && (i >= nevents)) break;
+    int failed = 0;
 
-    // read the data for i-th event
-    // data->GetEntry(i);
-    // Load selected branches with data from specified event
-    treeReader->ReadEntry(i);
-
-    std::map<std::string, std::any> DataStore;
-    DataStore["Jet"]                = branchPointer["Jet"];
-    DataStore["GenJet"]             = branchPointer["GenJet"];
-    DataStore["Particle"]           = branchPointer["Particle"];
-    DataStore["EFlowTrack"]         = branchPointer["EFlowTrack"];
-    DataStore["Track"]              = branchPointer["Track"];
-    DataStore["EFlowPhoton"]        = branchPointer["EFlowPhoton"];
-    DataStore["Electron"]           = branchPointer["Electron"];
-    DataStore["EFlowNeutralHadron"] = branchPointer["EFlowNeutralHadron"];
-    DataStore["MissingET"]          = branchPointer["MissingET"];
-    DataStore["Tower"]              = branchPointer["Tower"];
-    DataStore["BeamSpot"]           = branchPointer["BeamSpot"];
-
-    // PID system branches (lists of particles ID'd using PID systems)
-    DataStore["mRICHTrack"]      = branchPointer["mRICHTrack"];
-    DataStore["barrelDIRCTrack"] = branchPointer["barrelDIRCTrack"];
-    DataStore["dualRICHagTrack"] = branchPointer["dualRICHagTrack"];
-    DataStore["dualRICHcfTrack"] = branchPointer["dualRICHcfTrack"];
+    for (auto pid : children) {
+      int status = 0;
 
-    for (auto module : module_handler->getModules()) {
-      module->setJets(branchPointer["Jet"]);
-      module->setGenJets(branchPointer["GenJet"]);
-      module->setEFlowTracks(branchPointer["EFlowTrack"]);
-      module->setTracks(branchPointer["Track"]);
-      module->setGenParticles(branchPointer["Particle"]);
-      module->setPhotons(branchPointer["EFlowPhoton"]);
-      module->setElectrons(branchPointer["Electron"]);
-      module->setNeutralHadrons(branchPointer["EFlowNeutralHadron"]);
-      module->setMET(branchPointer["MissingET"]);
-
-      bool result = module->execute(&DataStore);
-
-      if (result == false) break;
+      if ((waitpid(pid, &status, 0) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) failed++;
     }
 
-    tree_handler->execute();
-
-    // Clean up the data store
-    // SJS: the DataStore contains object it owns and objects it does not
-    //      some of the latter are allocated using "new" and must be deleted.
-    //      this code slowly leaks memory because of this. FIX!
-    //      (problem: how to delete only objects we create in OLeAA?)
-
-    for (auto datum : DataStore) {
-      try {
-        // TObjArray* store_obj = std::any_cast<TObjArray*>(datum.second);
-        // for (Int_t i = 0; i < array->GetEntries(); i++) {
-        //   array->At(i)->Delete();
-        // }
-        // store_obj->Delete();
-      } catch (const std::bad_any_cast& e) {}
+    if (failed > 0) {
+      stringstream message;
+      message << failed << " of " << njobs << " worker processes failed; partial outputs are left in " << output_file << ".job*";
+      throw runtime_error(message.str());
     }
+
+    for (auto part : parts) {
+      readSummaries(part);
+    }
+
+    mergeOutputs(parts, output_file);
+  }
+
+  Double_t elapsed = std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
+
+  // Timing summary over all threads
+  for (size_t t = 1; t < timing_reports.size(); t++) {
+    timing_reports[0]->merge(*timing_reports[t]);
   }
+  timing_reports[0]->print(elapsed, n_process);
+  timing_reports[0]->writeJSON(output_file + ".timing.json", elapsed, n_process);
 
-  for (auto module : module_handler->getModules()) {
-    module->finalize();
+  // Cut flow over all threads
+  for (size_t t = 1; t < cut_flows.size(); t++) {
+    cut_flows[0]->merge(*cut_flows[t]);
   }
-  tree_handler->finalize();
+  cut_flows[0]->print();
+  cut_flows[0]->writeCSV(output_file + ".cutflow.csv");
 
 
   std::cout <<
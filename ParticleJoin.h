@@ -0,0 +1,102 @@
+#ifndef PARTICLEJOIN_HH
+#define PARTICLEJOIN_HH
+
+/**
+   Index of a candidate list (Track, EFlowTrack, Electron, Muon, the PID
+   track lists, ...) by the GenParticle each candidate references, built
+   once per event on the first lookup. Matching two lists through their
+   Particle references is then one hash lookup per candidate instead of a
+   scan of the other list.
+
+   Modules get the shared index of a list in their initialize() with
+   ParticleJoin::get(store, list, requester); it is kept in the DataStore
+   under "ParticleJoin:<list>".
+ **/
+
+#include <string>
+#include <unordered_map>
+
+#include "TObject.h"
+#include "TObjArray.h"
+
+#include "classes/DelphesClasses.h"
+#include "DataStore.h"
+
+class ParticleJoin {
+  friend class DataStore;
+
+public:
+
+  static ParticleJoin* get(DataStore *store, std::string list, std::string requester = "") {
+    std::string name = "ParticleJoin:" + list;
+
+    return store->shared<ParticleJoin>(name, requester, [&]() { return new ParticleJoin(store, list, requester); });
+  }
+
+  // Position in the list of the first candidate referencing this particle,
+  // or -1 if there is none (or the particle is nullptr)
+  Int_t index(TObject *particle) {
+    if (particle == nullptr) return -1;
+
+    if (!_built) build();
+
+    auto entry = _index.find(particle);
+
+    return (entry != _index.end()) ? entry->second : -1;
+  }
+
+  // First candidate referencing this particle, or nullptr
+  template <class T>
+  T* find(TObject *particle) {
+    Int_t i = index(particle);
+
+    return (i >= 0) ? static_cast<T *>(_store->get(_input)->At(i)) : nullptr;
+  }
+
+  // The GenParticle referenced by a candidate of any class with a Particle
+  // reference; nullptr for other classes
+  static TObject* particleOf(TObject *candidate) {
+    TClass *type = candidate->IsA();
+
+    if (type == Track::Class()) return static_cast<Track *>(candidate)->Particle.GetObject();
+    if (type == Electron::Class()) return static_cast<Electron *>(candidate)->Particle.GetObject();
+    if (type == Muon::Class()) return static_cast<Muon *>(candidate)->Particle.GetObject();
+    return nullptr;
+  }
+
+private:
+
+  ParticleJoin(DataStore *store, std::string list, std::string requester) {
+    _store = store;
+    _input = store->find<TObjArray>(list, requester, { "Particle" });
+
+    // The references point into the generated particles
+    store->find<TObjArray>("Particle", requester, { "PID" });
+  }
+
+  void build() {
+    TObjArray *list = _store->get(_input);
+
+    if (list != nullptr) {
+      for (Int_t i = 0; i < list->GetEntriesFast(); i++) {
+        TObject *particle = particleOf(list->At(i));
+
+        // Keep the first candidate of each particle
+        if (particle != nullptr) _index.emplace(particle, i);
+      }
+    }
+    _built = true;
+  }
+
+  void reset() {
+    _index.clear();
+    _built = false;
+  }
+
+  DataStore *_store = nullptr;
+  DataStore::Handle<TObjArray>_input;
+  std::unordered_map<TObject *, Int_t>_index;
+  Bool_t _built = false;
+};
+
+#endif // ifndef PARTICLEJOIN_HH
@@ -8,13 +8,14 @@
 
 #include "TreeHandler.h"
 
+#include <cmath>
+#include <limits>
+
 template <class T> RefinerModule<T>::RefinerModule(ExRootTreeReader* data, std::string name)
   : Module(data, name)
 {
   _params = std::map<std::string, std::string>();
   _refinements = std::map<std::string, std::pair<Double_t,Double_t>>();
-  _selectors = std::map<std::string, Selector<T>*>();
-  _outputList = new TObjArray();
 }
 
 template <class T> RefinerModule<T>::~RefinerModule()
@@ -70,112 +71,123 @@ template <class T> void RefinerModule<T>::initialize()
     }
 
   }
-  
 
-  _selectors["PT"] = new SelectorPT<T>("PT");
-  _selectors["Eta"] = new SelectorEta<T>("Eta");
-  _selectors["Phi"] = new SelectorPhi<T>("Phi");
-  _selectors["Q"] = new SelectorCharge<T>("Q");
+  // Optional event filter on the number of refined candidates
+  ExRootConfParam min_candidates = getConfiguration()->GetParam(Form("%s::minCandidates", getName().c_str()));
+  ExRootConfParam max_candidates = getConfiguration()->GetParam(Form("%s::maxCandidates", getName().c_str()));
+
+  if (min_candidates.GetSize() > 0) {
+    _min_candidates = min_candidates.GetInt();
+    std::cout << getName() << "::minCandidates: value set to " << _min_candidates << std::endl;
+  }
+  if (max_candidates.GetSize() > 0) {
+    _max_candidates = max_candidates.GetInt();
+    std::cout << getName() << "::maxCandidates: value set to " << _max_candidates << std::endl;
+  }
   
 
+  // Resolve the input list, reading only the leaves the selectors need, and
+  // register the output list. Whatever downstream modules read from the
+  // output list is read from the input list as well.
+  std::map<std::string, std::string> selector_leaves = {
+    {"PT", "PT"}, {"Eta", "Eta"}, {"Phi", "Phi"}, {"Q", "Charge"}
+  };
+  std::vector<std::string> leaves;
+  for (auto refinement : _refinements) {
+    if (selector_leaves.find(refinement.first) != selector_leaves.end()) {
+      leaves.push_back(selector_leaves[refinement.first]);
+    }
+  }
+  if (leaves.empty()) leaves.push_back("PT");
+
+  _inputHandle = getDataStore()->template find<TObjArray>(_params["inputList"], getName() + "::RefinerModule", leaves);
+  _outputHandle = getDataStore()->bookList(_params["outputList"], getName() + "::RefinerModule");
+  getDataStore()->derive(_outputHandle, _inputHandle);
+  _outputList = getDataStore()->get(_outputHandle);
+
+  // Compile the selections into a flat list of range checks on one field
+  // each; selectors with other names are ignored, as before
+  std::map<std::string, Field> fields = {
+    {"PT", kPT}, {"Eta", kEta}, {"Phi", kPhi}, {"Q", kCharge}
+  };
+  for (auto refinement : _refinements) {
+    if (fields.find(refinement.first) != fields.end()) {
+      Cut cut;
+
+      cut.field = fields[refinement.first];
+      cut.min   = refinement.second.first;
+      cut.max   = refinement.second.second;
+
+      if (cut.min < refinement.second.first) cut.min = std::nextafter(cut.min, std::numeric_limits<Float_t>::infinity());
+      if (cut.max > refinement.second.second) cut.max = std::nextafter(cut.max, -std::numeric_limits<Float_t>::infinity());
+
+      _cuts.push_back(cut);
+    }
+  }
 }
 
 template <class T> void RefinerModule<T>::finalize()
 {
-  for (auto s : _selectors) {
-    delete s.second;
+}
+
+template <class T> template <class S> void RefinerModule<T>::gather(Int_t n)
+{
+  T** candidates = _candidates.data();
+  Float_t* values = _values.data();
+
+  for (Int_t i = 0; i < n; i++) {
+    values[i] = S::value(candidates[i]);
   }
 }
-template <class T> bool RefinerModule<T>::execute(std::map<std::string, std::any>* DataStore)
+template <class T> bool RefinerModule<T>::execute(DataStore* store)
 {
   auto data = getData();
 
-  TObjArray* inputList = nullptr;
-  
-  // search in the DataStore for this list
-  if (DataStore->find(_params["inputList"]) != DataStore->end()) {
-    try {
-      inputList = std::any_cast<TObjArray* >((*DataStore)[_params["inputList"]]);
-    } catch(const std::bad_any_cast& e)
-    {
-      try {
-	inputList = std::any_cast<TClonesArray* >((*DataStore)[_params["inputList"]]);
-      } catch (const std::bad_any_cast& e)
-	{
-	  std::stringstream message;
-	  message << "Input list " << _params["inputList"] << " must be either TObjArray or TClonesArray! [" << getName() << "::RefinerModule]" << std::endl;
-	  throw std::runtime_error(message.str());
-	}
-    }
-  } else {
-    std::stringstream message;
-    message << "Unable to locate " << _params["inputList"] << " specified in module " << getName() << " of class RefinerModule!" << std::endl;
-    throw std::runtime_error(message.str());
+  TObjArray* inputList = store->get(_inputHandle);
+
+  // Apply refinements to the contents of the inputList to generate the
+  // outputList: each cut reads its field for all candidates into a
+  // contiguous buffer, then updates the pass mask in one branch-free loop
+  Int_t n = inputList->GetEntriesFast();
+
+  _candidates.resize(n);
+  _values.resize(n);
+  _pass.assign(n, 1);
+
+  for (Int_t i = 0; i < n; i++) {
+    _candidates[i] = static_cast<T*>(inputList->UncheckedAt(i));
   }
-  // Write a new list of refined candidates to the outputList
-  if (DataStore->find(_params["outputList"]) != DataStore->end()) {
-    // Do not allow overwrites of existing contents in the DataStore
-    std::stringstream message;
-    message << "An object named " << _params["outputList"] << " already exists in the DataStore! [" << getName() << "::RefinerModule]" << std::endl;
-    throw std::runtime_error(message.str());
-  }    
-
-  if (_outputList != nullptr && _outputList->GetEntries() > 0) {
-    for (Int_t i = 0; i < _outputList->GetEntries(); i++) {
-      delete _outputList->At(i);
+
+  for (auto cut : _cuts) {
+    switch (cut.field) {
+    case kPT:     gather< SelectorPT<T> >(n);     break;
+    case kEta:    gather< SelectorEta<T> >(n);    break;
+    case kPhi:    gather< SelectorPhi<T> >(n);    break;
+    case kCharge: gather< SelectorCharge<T> >(n); break;
     }
-    _outputList->Clear();
-  }
 
-  // Apply refinements to the contents of the inputList to generate the outputList
-  TIter iterator(inputList);
-  iterator.Reset();
-  Candidate* candidate = nullptr;
-  // while((candidate = static_cast<Candidate *>(iterator.Next()))) {
-  for (int i = 0; i < inputList->GetEntries(); i++) {
-    T* candidate  = static_cast<T*>(inputList->At(i));
-    Bool_t keepCandidate = kTRUE;
-
-    for (auto selection : _refinements) {
-      std::string varName = selection.first;
-      std::pair<Double_t, Double_t> varRange = selection.second;
-
-      Double_t varValue = 0.0;
-
-      if (varName == "PT") {
-	if (_selectors.find(varName) != _selectors.end()) {
-	  keepCandidate &= _selectors[varName]->select(candidate, varRange);
-	}
-      }
-      else if (varName == "Eta") {
-	if (_selectors.find(varName) != _selectors.end()) {
-	  keepCandidate &= _selectors[varName]->select(candidate, varRange);
-	}
-      }
-      else if (varName == "Phi") {
-	if (_selectors.find(varName) != _selectors.end()) {
-	  keepCandidate &= _selectors[varName]->select(candidate, varRange);
-	}
-      }
-      else if (varName == "Q") {
-	if (_selectors.find(varName) != _selectors.end()) {
-	  auto selector = static_cast< SelectorCharge<T>* >(_selectors[varName]);
-	  selector-> template select<T>(candidate, varRange, &keepCandidate);
-	}
-      }
+    const Float_t* values = _values.data();
+    const Float_t min = cut.min;
+    const Float_t max = cut.max;
+    UChar_t* pass = _pass.data();
 
+    for (Int_t i = 0; i < n; i++) {
+      pass[i] &= (min <= values[i]) & (values[i] <= max);
     }
-    if (keepCandidate) {
-      Candidate* new_candidate = static_cast<Candidate*>(candidate->Clone());
-      //new_candidate->Particle = candidate->Particle; // breaks for Photon objects
-      _outputList->AddLast(new_candidate);
+  }
+
+  // The output list is a view: it points at the input candidates, which
+  // stay valid for the whole event, rather than holding copies
+  for (Int_t i = 0; i < n; i++) {
+    if (_pass[i]) {
+      _outputList->AddLast(_candidates[i]);
     }
   }
 
   // std::cout << "[" << getName() << "::RefinerModule]: candidate reduction is "<< inputList->GetEntries() << " => " << _outputList->GetEntries() << std::endl;
 
-  (*DataStore)[_params["outputList"]] = _outputList;
+  Int_t n_out = _outputList->GetEntriesFast();
 
-  return true;
+  return (n_out >= _min_candidates) && ((_max_candidates < 0) || (n_out <= _max_candidates));
 }
 
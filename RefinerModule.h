@@ -35,9 +35,15 @@ public:
   ~RefinerModule();
   
   void initialize() override;
-  bool execute(std::map<std::string, std::any>* DataStore) override;
+  bool execute(DataStore* store) override;
   void finalize() override;
 
+  // A refiner with minCandidates or maxCandidates rejects events whose
+  // output list has a number of candidates outside that range
+  bool isFilter() override {
+    return (_min_candidates > 0) || (_max_candidates >= 0);
+  };
+
   // parameter-setting methods
   void setParam(std::string param, std::string value) {
     _params[param] = value;
@@ -59,13 +65,40 @@ public:
   std::map<std::string,std::string> _params;
   std::map<std::string, std::pair<Double_t,Double_t>> _refinements;
 
-  std::map<std::string, Selector<T>*> _selectors; 
+  // Selections compiled at initialize: the field each one reads and the
+  // accepted range. The fields are single precision in Delphes (the charge
+  // is a small integer), so the range is kept in single precision too, with
+  // the bounds rounded inward: it accepts exactly the values that the
+  // configured double-precision range accepts.
+  enum Field { kPT, kEta, kPhi, kCharge };
+  struct Cut {
+    Field field;
+    Float_t min;
+    Float_t max;
+  };
+  std::vector<Cut> _cuts;
+
+  // Accepted range of the output list size; -1 means no upper limit
+  Int_t _min_candidates = 0;
+  Int_t _max_candidates = -1;
+
+  // Per-event buffers: the input candidates, the field of the current cut
+  // and the pass mask
+  std::vector<T*> _candidates;
+  std::vector<Float_t> _values;
+  std::vector<UChar_t> _pass;
 
   TObjArray* _outputList = nullptr;
+
+  DataStore::Handle<TObjArray> _inputHandle;
+  DataStore::Handle<TObjArray> _outputHandle;
   
  private:
   // Methods internal to the class
 
+  // Read one field of every input candidate into _values
+  template <class S> void gather(Int_t n);
+
   //
   // Class-dependent object cloning
   //
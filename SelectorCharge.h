@@ -5,6 +5,7 @@
 #include <map>
 #include <string>
 #include <any>
+#include <type_traits>
 
 #include "Selector.h"
 
@@ -19,45 +20,24 @@ class SelectorCharge : public Selector<T> {
 
   bool select(T* obj, std::pair<Double_t, Double_t> range)
   {
-    return true;
+    return (range.first <= value(obj) && value(obj) <= range.second);
   }
 
-  //
-  // Class-dependent object charge computation
-  //
-  template<typename U = T>
-  typename std::enable_if<std::is_same<U, Track>::value>::type
-  select(U* obj, std::pair<Double_t, Double_t> range, Bool_t* selected)
+  // The selected quantity, for selections compiled by RefinerModule;
+  // photons are neutral
+  static Double_t value(T* obj)
   {
-    (*selected) &= (range.first <= obj->Charge && obj->Charge <= range.second);
+    if constexpr (std::is_same<T, Photon>::value) {
+      return 0.0;
+    } else {
+      return obj->Charge;
+    }
   }
 
-  template<typename U = T>
-  typename std::enable_if<std::is_same<U, Electron>::value>::type
-  select(U* obj, std::pair<Double_t, Double_t> range, Bool_t* selected)
+  // Same as select(), for callers that accumulate a decision
+  void select(T* obj, std::pair<Double_t, Double_t> range, Bool_t* selected)
   {
-    (*selected) &= (range.first <= obj->Charge && obj->Charge <= range.second);
-  }
-
-  template<typename U = T>
-  typename std::enable_if<std::is_same<U, Muon>::value>::type
-  select(U* obj, std::pair<Double_t, Double_t> range, Bool_t* selected)
-  {
-    (*selected) &= (range.first <= obj->Charge && obj->Charge <= range.second);
-  }
-  
-  template<typename U = T>
-  typename std::enable_if<std::is_same<U, Jet>::value>::type
-  select(U* obj, std::pair<Double_t, Double_t> range, Bool_t* selected)
-  {
-    (*selected) &= (range.first <= obj->Charge && obj->Charge <= range.second);
-  }
-  
-  template<typename U = T>
-  typename std::enable_if<std::is_same<U, Photon>::value>::type
-  select(U* obj, std::pair<Double_t, Double_t> range, Bool_t* selected)
-  {
-    (*selected) &= (range.first <= 0.0 && 0.0 <= range.second);
+    (*selected) &= select(obj, range);
   }
 
  private:
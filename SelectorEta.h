@@ -19,8 +19,13 @@ class SelectorEta : public Selector<T> {
 
   virtual bool select(T* obj, std::pair<Double_t, Double_t> range)
   {
-    //std::cout << range.first << " <= " << obj->Eta << " <= " << range.second << "?" << std::endl;
-    return (range.first <= obj->Eta && obj->Eta <= range.second);
+    return (range.first <= value(obj) && value(obj) <= range.second);
+  }
+
+  // The selected quantity, for selections compiled by RefinerModule
+  static Double_t value(T* obj)
+  {
+    return obj->Eta;
   }
 
  private:
@@ -19,8 +19,13 @@ class SelectorPT : public Selector<T> {
 
   virtual bool select(T* obj, std::pair<Double_t, Double_t> range)
   {
-    //std::cout << range.first << " <= " << obj->PT << " <= " << range.second << "?" << std::endl;
-    return (range.first <= obj->PT && obj->PT <= range.second);
+    return (range.first <= value(obj) && value(obj) <= range.second);
+  }
+
+  // The selected quantity, for selections compiled by RefinerModule
+  static Double_t value(T* obj)
+  {
+    return obj->PT;
   }
 
  private:
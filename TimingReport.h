@@ -0,0 +1,247 @@
+#ifndef TIMINGREPORT_HH
+#define TIMINGREPORT_HH
+
+/**
+   Wall-clock and CPU time of each stage of the event loop (ReadEntry, every
+   module's execute(), TreeHandler::execute), one call per event. Times are
+   accumulated in log-binned histograms, so reports from several threads or
+   jobs are merged by adding histograms (which TFileMerger/hadd also do with
+   the copies written to the output file). Totals and means come from the
+   histogram statistics and are exact; percentiles are interpolated within a
+   bin (10 bins per decade).
+ **/
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <time.h>
+
+#include "TH1D.h"
+#include "TDirectory.h"
+#include "TKey.h"
+#include "TString.h"
+
+class TimingReport {
+public:
+
+  TimingReport() {}
+
+  TimingReport(const TimingReport&)            = delete;
+  TimingReport& operator=(const TimingReport&) = delete;
+
+  ~TimingReport() {
+    for (auto stage : _stages) {
+      delete stage.wall;
+      delete stage.cpu;
+    }
+  }
+
+  // Register a stage; the returned index is passed to lap()
+  Int_t addStage(std::string name) {
+    Stage stage;
+    TString hname = TString(name).ReplaceAll(":", "_");
+
+    stage.name = name;
+    stage.wall = new TH1D(Form("Timing_%s_wall", hname.Data()), Form("%s;wall time [s];calls", name.c_str()),
+                          _nbins, binEdges().data());
+    stage.cpu  = new TH1D(Form("Timing_%s_cpu", hname.Data()), Form("%s;CPU time [s];calls", name.c_str()),
+                          _nbins, binEdges().data());
+    stage.wall->SetDirectory(nullptr);
+    stage.cpu->SetDirectory(nullptr);
+
+    _stages.push_back(stage);
+    return _stages.size() - 1;
+  }
+
+  // Start timing from now
+  void mark() {
+    _wall_mark = wallTime();
+    _cpu_mark  = cpuTime();
+  }
+
+  // Attribute the time since the last mark (or lap) to a stage
+  void lap(Int_t stage) {
+    Double_t wall = wallTime();
+    Double_t cpu  = cpuTime();
+
+    _stages[stage].wall->Fill(wall - _wall_mark);
+    _stages[stage].cpu->Fill(cpu - _cpu_mark);
+
+    _wall_mark = wall;
+    _cpu_mark  = cpu;
+  }
+
+  // Add the stages of another report, matching them by name
+  void merge(const TimingReport& other) {
+    for (auto theirs : other._stages) {
+      Int_t index = stage(theirs.name);
+
+      _stages[index].wall->Add(theirs.wall);
+      _stages[index].cpu->Add(theirs.cpu);
+    }
+  }
+
+  // Add the histograms that writeHistograms() put in a file (e.g. the output
+  // of a worker process), matching stages by name (the histogram title)
+  void readHistograms(TDirectory *file) {
+    TDirectory *dir = file->GetDirectory("Timing");
+
+    if (dir == nullptr) return;
+
+    TIter next(dir->GetListOfKeys());
+
+    while (TKey *key = static_cast<TKey *>(next())) {
+      TString wall_name = key->GetName();
+
+      if (!wall_name.EndsWith("_wall")) continue;
+
+      TString cpu_name = TString(wall_name(0, wall_name.Length() - 5)) + "_cpu";
+      TH1D   *wall     = dir->Get<TH1D>(wall_name.Data());
+      TH1D   *cpu      = dir->Get<TH1D>(cpu_name.Data());
+
+      if ((wall == nullptr) || (cpu == nullptr)) continue;
+
+      Int_t index = stage(wall->GetTitle());
+
+      _stages[index].wall->Add(wall);
+      _stages[index].cpu->Add(cpu);
+    }
+  }
+
+  void print(Double_t elapsed, Long64_t events) {
+    // Leave std::cout formatted as it was for the reports that follow
+    std::ios::fmtflags flags     = std::cout.flags();
+    std::streamsize    precision = std::cout.precision();
+
+    std::cout << "================================ Timing ================================" << std::endl;
+    std::cout << std::left << std::setw(28) << "Stage" << std::right
+              << std::setw(10) << "Calls"
+              << std::setw(11) << "Mean [ms]"
+              << std::setw(11) << "p50 [ms]"
+              << std::setw(11) << "p99 [ms]"
+              << std::setw(11) << "Wall [s]"
+              << std::setw(11) << "CPU [s]" << std::endl;
+
+    for (auto stage : _stages) {
+      std::cout << std::left << std::setw(28) << stage.name << std::right
+                << std::setw(10) << Long64_t(stage.wall->GetEntries())
+                << std::fixed << std::setprecision(3)
+                << std::setw(11) << 1e3 * stage.wall->GetMean()
+                << std::setw(11) << 1e3 * quantile(stage.wall, 0.50)
+                << std::setw(11) << 1e3 * quantile(stage.wall, 0.99)
+                << std::setw(11) << total(stage.wall)
+                << std::setw(11) << total(stage.cpu) << std::endl;
+    }
+    std::cout << "Processed " << events << " events in " << elapsed << " s";
+    if (elapsed > 0.0) std::cout << " (" << events / elapsed << " events/s)";
+    std::cout << std::endl;
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+  }
+
+  void writeJSON(std::string filename, Double_t elapsed, Long64_t events) {
+    std::ofstream out(filename);
+
+    out << std::setprecision(9);
+    out << "{" << std::endl;
+    out << "  \"events\": " << events << "," << std::endl;
+    out << "  \"wall_seconds\": " << elapsed << "," << std::endl;
+    out << "  \"events_per_second\": " << ((elapsed > 0.0) ? events / elapsed : 0.0) << "," << std::endl;
+    out << "  \"stages\": [" << std::endl;
+
+    for (size_t s = 0; s < _stages.size(); s++) {
+      out << "    { \"name\": \"" << _stages[s].name << "\", \"calls\": " << Long64_t(_stages[s].wall->GetEntries()) << "," << std::endl;
+      out << "      \"wall\": " << summary(_stages[s].wall) << "," << std::endl;
+      out << "      \"cpu\": " << summary(_stages[s].cpu) << " }";
+      out << ((s + 1 < _stages.size()) ? "," : "") << std::endl;
+    }
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+
+    if (!out.good()) {
+      std::cout << "TimingReport: unable to write " << filename << std::endl;
+    }
+  }
+
+  // Write the histograms into a "Timing" directory of the given file,
+  // replacing those of an earlier write (e.g. at a checkpoint)
+  void writeHistograms(TDirectory *file) {
+    TDirectory *dir = file->GetDirectory("Timing");
+
+    if (dir == nullptr) dir = file->mkdir("Timing");
+
+    dir->cd();
+    for (auto stage : _stages) {
+      stage.wall->Write("", TObject::kOverwrite);
+      stage.cpu->Write("", TObject::kOverwrite);
+    }
+    file->cd();
+  }
+
+private:
+
+  struct Stage {
+    std::string name;
+    TH1D *wall = nullptr;
+    TH1D *cpu  = nullptr;
+  };
+
+  // Index of the stage with this name, added if there is none
+  Int_t stage(std::string name) {
+    for (size_t s = 0; s < _stages.size(); s++) {
+      if (_stages[s].name == name) return s;
+    }
+    return addStage(name);
+  }
+
+  // 10 ns to 10 ks, 10 bins per decade
+  static const Int_t _nbins = 120;
+
+  static std::vector<Double_t>binEdges() {
+    std::vector<Double_t> edges;
+
+    for (Int_t b = 0; b <= _nbins; b++) {
+      edges.push_back(std::pow(10.0, -8.0 + b / 10.0));
+    }
+    return edges;
+  }
+
+  static Double_t wallTime() {
+    return std::chrono::duration<Double_t>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  // CPU time of the calling thread only
+  static Double_t cpuTime() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + 1e-9 * ts.tv_nsec;
+  }
+
+  static Double_t total(TH1D *h) {
+    return h->GetMean() * h->GetEntries();
+  }
+
+  static Double_t quantile(TH1D *h, Double_t p) {
+    if (h->GetEntries() == 0) return 0.0;
+
+    Double_t q = 0.0;
+    h->GetQuantiles(1, &q, &p);
+    return q;
+  }
+
+  static std::string summary(TH1D *h) {
+    return Form("{ \"total\": %.9g, \"mean\": %.9g, \"p50\": %.9g, \"p99\": %.9g }",
+                total(h), h->GetMean(), quantile(h, 0.50), quantile(h, 0.99));
+  }
+
+  std::vector<Stage>_stages;
+  Double_t _wall_mark = 0.0;
+  Double_t _cpu_mark  = 0.0;
+};
+
+#endif // ifndef TIMINGREPORT_HH
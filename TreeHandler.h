@@ -2,17 +2,28 @@
 #define TREEHANDLER_HH
 
 #include <iostream>
+#include <iomanip>
 #include <vector>
 #include <string>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
 
 #include "TFile.h"
 #include "TTree.h"
+#include "TBranch.h"
+#include "TObjArray.h"
+#include "TSystem.h"
+#include "Compression.h"
 #include "external/ExRootAnalysis/ExRootTreeReader.h"
+#include "external/ExRootAnalysis/ExRootConfReader.h"
 
 using namespace std;
 
 class TreeHandler {
-  static TreeHandler *instance;
+  static thread_local TreeHandler *instance;
   
   TFile* _file = nullptr;
   TTree* _tree = nullptr;
@@ -39,16 +50,122 @@ class TreeHandler {
     return this -> _tree;
   }
 
-  void initialize() {
-    _file = new TFile(_filename.c_str(), "RECREATE");
+  // Output policy from the TCL configuration, all optional:
+  //   OutputCompressionAlgorithm  ZLIB, LZMA, LZ4 or ZSTD
+  //   OutputCompressionLevel      0 (uncompressed) to 9
+  //   OutputBasketSize            initial buffer size of each branch, in bytes
+  //   OutputClusterSize           TTree::SetAutoFlush: entries if > 0, bytes if < 0
+  //   OutputImplicitMT            compress the baskets of each Fill in parallel
+  //                               (default: as ROOT, i.e. when implicit MT is on)
+  void configure(ExRootConfReader *config) {
+    std::map<TString, ROOT::RCompressionSetting::EAlgorithm::EValues> algorithms = {
+      { "ZLIB", ROOT::RCompressionSetting::EAlgorithm::kZLIB },
+      { "LZMA", ROOT::RCompressionSetting::EAlgorithm::kLZMA },
+      { "LZ4",  ROOT::RCompressionSetting::EAlgorithm::kLZ4  },
+      { "ZSTD", ROOT::RCompressionSetting::EAlgorithm::kZSTD }
+    };
+    // ROOT's default level for each algorithm
+    std::map<TString, Int_t> default_levels = { { "ZLIB", 1 }, { "LZMA", 7 }, { "LZ4", 4 }, { "ZSTD", 5 } };
+
+    TString algorithm = TString(config->GetString("::OutputCompressionAlgorithm", "")).Strip(TString::kBoth);
+    Int_t   level     = config->GetInt("::OutputCompressionLevel", -1);
+
+    algorithm.ToUpper();
+
+    if ((algorithm != "") && (algorithms.find(algorithm) == algorithms.end())) {
+      std::stringstream message;
+      message << "Unknown OutputCompressionAlgorithm " << algorithm.Data() << "; use ZLIB, LZMA, LZ4 or ZSTD [TreeHandler]" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+
+    if ((level < -1) || (level > 9)) {
+      std::stringstream message;
+      message << "OutputCompressionLevel " << level << " is not between 0 and 9 [TreeHandler]" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+
+    if (algorithm != "") {
+      _compression = ROOT::CompressionSettings(algorithms[algorithm], (level >= 0) ? level : default_levels[algorithm]);
+    }
+    _compression_level = level;
+
+    _basket_size  = config->GetInt("::OutputBasketSize", _basket_size);
+    _cluster_size = config->GetInt("::OutputClusterSize", 0);
+
+    if (config->GetParam("::OutputImplicitMT").GetSize() > 0) {
+      _implicit_mt = config->GetBool("::OutputImplicitMT", kFALSE) ? 1 : 0;
+    }
+  }
+
+  // With resume, an existing output file is reopened and the tree saved at
+  // its last checkpoint is read back, so that filling continues after it
+  void initialize(bool resume = false) {
+    if (resume && !gSystem->AccessPathName(_filename.c_str())) {
+      _file = new TFile(_filename.c_str(), "UPDATE");
+
+      if (!_file->IsZombie()) _tree = _file->Get<TTree>(_treename.c_str());
+      if (_tree == nullptr) {
+        delete _file;
+        _file = nullptr;
+      }
+    }
+
+    _resumed = (_tree != nullptr);
+
+    if (!_resumed) {
+      _file = new TFile(_filename.c_str(), "RECREATE");
+      _file->cd();
+      _tree = new TTree(_treename.c_str(), "");
+    }
+    _file->cd();
+
+    // Applies to the baskets written from now on
+    if (_compression >= 0) _file->SetCompressionSettings(_compression);
+    else if (_compression_level >= 0) _file->SetCompressionLevel(_compression_level);
+
+    if (_cluster_size != 0) _tree->SetAutoFlush(_cluster_size);
+    if (_implicit_mt >= 0) _tree->SetImplicitMT(_implicit_mt == 1);
+  }
+
+  // Whether initialize() reopened a checkpointed output
+  bool resumed() {
+    return _resumed;
+  }
+
+  // Add a branch of fundamental type (leaflist e.g. "x/D") to the output
+  // tree or, for a resumed tree, attach the existing branch to the address
+  void branch(const char *name, void *address, const char *leaflist) {
+    TBranch *existing = _tree->GetBranch(name);
+
+    if (existing != nullptr) existing->SetAddress(address);
+    else _tree->Branch(name, address, leaflist, _basket_size);
+  }
+
+  // Same for a branch of objects of a class (e.g. "std::vector<Double_t>")
+  template <class T> void branch(const char *name, const char *classname, T *object) {
+    TBranch *existing = _tree->GetBranch(name);
+
+    if (existing != nullptr) existing->SetObject(object);
+    else _tree->Branch(name, classname, object, _basket_size);
+  }
+
+  // Write the baskets filled so far and the tree header, so that the file
+  // can be reopened with the tree as it is now
+  void checkpoint() {
+    if ((_tree == nullptr) || (_file == nullptr))
+      return;
     _file->cd();
-    _tree = new TTree(_treename.c_str(), "");
+    _tree->AutoSave("SaveSelf;FlushBaskets");
   }
 
   void execute() {
     if (_tree == nullptr)
       return;
+
+    auto start = std::chrono::steady_clock::now();
+
     _tree->Fill();
+    _fill_seconds += std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count();
   }
 
   void finalize() {
@@ -57,13 +174,67 @@ class TreeHandler {
     if (_file == nullptr)
       return;
     _file->cd();
-    _tree->Write();
+
+    auto start = std::chrono::steady_clock::now();
+
+    _tree->Write("", TObject::kOverwrite);
+    printStatistics(std::chrono::duration<Double_t>(std::chrono::steady_clock::now() - start).count());
     _file->Close();
   }
 
  private:
+
+  // Size of the output and time spent filling (serializing and compressing)
+  // and writing it, with the largest branches
+  void printStatistics(Double_t write_seconds) {
+    std::ios::fmtflags flags     = std::cout.flags();
+    std::streamsize    precision = std::cout.precision();
+
+    Long64_t raw = _tree->GetTotBytes();
+    Long64_t zip = _tree->GetZipBytes();
+
+    std::cout << "TreeHandler: " << _filename << ": " << _tree->GetEntries() << " entries, "
+              << std::fixed << std::setprecision(2)
+              << raw / 1e6 << " MB uncompressed, " << zip / 1e6 << " MB compressed"
+              << " (ratio " << ((zip > 0) ? Double_t(raw) / zip : 0.0) << ", settings "
+              << _file->GetCompressionSettings() << "); "
+              << "Fill " << _fill_seconds << " s, final write " << write_seconds << " s" << std::endl;
+
+    std::vector<std::pair<Long64_t, TBranch *> > branches;
+    TObjArray *list = _tree->GetListOfBranches();
+
+    for (Int_t b = 0; (list != nullptr) && (b < list->GetEntriesFast()); b++) {
+      TBranch *branch = static_cast<TBranch *>(list->At(b));
+      branches.push_back(std::make_pair(branch->GetZipBytes("*"), branch));
+    }
+
+    std::sort(branches.begin(), branches.end(), [](const std::pair<Long64_t, TBranch *>& lhs, const std::pair<Long64_t, TBranch *>& rhs) {
+                return lhs.first > rhs.first;
+              });
+
+    for (size_t b = 0; (b < branches.size()) && (b < 10); b++) {
+      Long64_t branch_raw = branches[b].second->GetTotBytes("*");
+
+      std::cout << "    " << std::left << std::setw(40) << branches[b].second->GetName() << std::right
+                << std::setw(10) << branches[b].first / 1e6 << " MB"
+                << " (ratio " << ((branches[b].first > 0) ? Double_t(branch_raw) / branches[b].first : 0.0) << ")" << std::endl;
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+  }
+
   std::string _filename;
   std::string _treename;
+  bool _resumed = false;
+
+  // Output policy (see configure()); -1 keeps ROOT's default
+  Int_t _compression       = -1;
+  Int_t _compression_level = -1;
+  Int_t _basket_size       = 32000;
+  Long64_t _cluster_size   = 0;
+  Int_t _implicit_mt       = -1;
+
+  Double_t _fill_seconds = 0.0;
 
 };
 
@@ -4,8 +4,8 @@
 TreeWriterModule::TreeWriterModule(ExRootTreeReader *data, std::string name)
   : Module(data, name)
 {
-  _global_vars    = std::map<TString, Double_t>();
-  _candidate_vars = std::map<TString, std::vector<Double_t> >();
+  _global_vars    = std::map<TString, StorageType>();
+  _candidate_vars = std::map<TString, StorageType>();
 
 
   _mpi = TDatabasePDG().GetParticle(211)->Mass();
@@ -16,7 +16,6 @@ TreeWriterModule::TreeWriterModule(ExRootTreeReader *data, std::string name)
 
 
   // Correcting ECAL/HCAL energy distribution using Full Simulation
-  _cache_emfrac = std::map<SortableObject *, Double_t>();
   _emfrac_file  = TFile::Open("share/EMRatioPDFs.root");
 }
 
@@ -27,6 +26,9 @@ void TreeWriterModule::initialize()
 {
   // Tree handler initialization
   TreeHandler *tree_handler = tree_handler->getInstance();
+  DataStore   *store        = getDataStore();
+
+  std::map<TString, DataStore::Handle<TObjArray> > list_handles;
 
   if (tree_handler->getTree() != nullptr) {
     ExRootConfParam p = getConfiguration()->GetParam(Form("%s::branches", getName().c_str()));
@@ -55,93 +57,127 @@ void TreeWriterModule::initialize()
           // no list name ... treat these like global variables.
 
           if (varName == "MET") {
-            _global_vars[blockName + "_MET_ET"]  = Double_t(0.0);
-            _global_vars[blockName + "_MET_Phi"] = Double_t(0.0);
+            _met_handle = store->find<TObjArray>("MissingET", getName() + "::TreeWriterModule", { "MET", "Phi" });
+
+            _global_vars[blockName + "_MET_ET"]  = kFloat;
+            _global_vars[blockName + "_MET_Phi"] = kFloat;
           } else if (varName == "DIS") {
-            _global_vars[blockName + "_BJx"]  = Double_t(0.0);
-            _global_vars[blockName + "_BJy"]  = Double_t(0.0);
-            _global_vars[blockName + "_BJQ2"] = Double_t(0.0);
-            _global_vars[blockName + "_JBx"]  = Double_t(0.0);
-            _global_vars[blockName + "_JBQ2"] = Double_t(0.0);
+            _particle_handle      = store->find<TObjArray>("Particle", getName() + "::TreeWriterModule",
+                                                           { "Px", "Py", "Pz", "E" });
+            // Jacquet-Blondel sums run over column views of the flow lists
+            _eflowtrack_soa    = EventSoA::get(store, "EFlowTrack", getName() + "::TreeWriterModule",
+                                               { "PT", "Eta", "Phi", "Mass" });
+            _photon_soa        = EventSoA::get(store, "EFlowPhoton", getName() + "::TreeWriterModule",
+                                               { "PT", "Eta", "Phi", "E" });
+            _neutralhadron_soa = EventSoA::get(store, "EFlowNeutralHadron", getName() + "::TreeWriterModule",
+                                               { "ET", "Eta", "Phi", "E" });
+
+            _global_vars[blockName + "_BJx"]  = kFloat;
+            _global_vars[blockName + "_BJy"]  = kFloat;
+            _global_vars[blockName + "_BJQ2"] = kFloat;
+            _global_vars[blockName + "_JBx"]  = kFloat;
+            _global_vars[blockName + "_JBQ2"] = kFloat;
           }
         } else {
-          // A list provided means we compute for each list item
+          // A list provided means we compute for each list item. Declare
+          // the leaves this variable block reads from the list.
           TString prefix = blockName + "_" + listName;
 
+          list_handles[listName] = store->find<TObjArray>(listName.Data(), getName() + "::TreeWriterModule",
+                                                          candidateLeaves(store->getClassName(listName.Data()), varName));
+
           if (varName == "Kinematics") {
-            _candidate_vars[prefix + "_KIN_PT"]  = std::vector<Double_t>();
-            _candidate_vars[prefix + "_KIN_Eta"] = std::vector<Double_t>();
-            _candidate_vars[prefix + "_KIN_Phi"] = std::vector<Double_t>();
-            _candidate_vars[prefix + "_KIN_M"]   = std::vector<Double_t>();
+            _candidate_vars[prefix + "_KIN_PT"]  = kFloat;
+            _candidate_vars[prefix + "_KIN_Eta"] = kFloat;
+            _candidate_vars[prefix + "_KIN_Phi"] = kFloat;
+            _candidate_vars[prefix + "_KIN_M"]   = kFloat;
           } else if (varName == "Calorimeter") {
-            _candidate_vars[prefix + "_CALO_Eem"]  = std::vector<Double_t>();
-            _candidate_vars[prefix + "_CALO_Ehad"] = std::vector<Double_t>();
+            _calo          = CaloAssociation::get(store, "Tower", getName() + "::TreeWriterModule");
+            _emfrac_handle = store->find<EMFractionMap>("EMFracMap", getName() + "::TreeWriterModule");
+
+            _candidate_vars[prefix + "_CALO_Eem"]  = kFloat;
+            _candidate_vars[prefix + "_CALO_Ehad"] = kFloat;
           } else if (varName == "Truth") {
-            _candidate_vars[prefix + "_TRU_ID"]  = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TRU_PT"]  = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TRU_Eta"] = std::vector<Double_t>();
+            store->find<TObjArray>("GenJet", getName() + "::TreeWriterModule", { "PT", "Eta" });
+            _particle_handle = store->find<TObjArray>("Particle", getName() + "::TreeWriterModule",
+                                                      { "PID", "Charge", "PT", "Eta" });
+
+            // Closest generator-level jet within dR < 0.5; closest generated
+            // particle of the same charge, at any distance
+            _genjet_match   = DeltaRMatcher::get(store, "GenJet", 0.5, kFALSE, getName() + "::TreeWriterModule");
+            _particle_match = DeltaRMatcher::get(store, "Particle", std::numeric_limits<Double_t>::infinity(), kTRUE,
+                                                 getName() + "::TreeWriterModule");
+
+            _candidate_vars[prefix + "_TRU_ID"]  = kInt32;
+            _candidate_vars[prefix + "_TRU_PT"]  = kFloat;
+            _candidate_vars[prefix + "_TRU_Eta"] = kFloat;
           } else if (varName == "PID") {
-            _candidate_vars[prefix + "_PID_ID"] = std::vector<Double_t>();
+            _candidate_vars[prefix + "_PID_ID"] = kInt32;
           } else if (varName == "JetTagging") {
-            _candidate_vars[prefix + "_TAG_jet_charge_05"]   = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_sIP3DTagger"]     = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_kTagger"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_CharmIPXDTagger"] = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_d0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_d0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_z0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_z0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t1_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_d0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_d0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_z0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_z0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t2_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_d0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_d0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_z0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_z0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t3_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_d0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_d0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_z0"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_z0err"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_t4_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k1_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k1_q"]            = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k1_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k1_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k1_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k2_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k2_q"]            = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k2_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k2_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_k2_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e1_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e1_q"]            = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e1_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e1_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e1_IP2D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e2_PT"]           = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e2_q"]            = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e2_sIP3D"]        = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e2_IP3D"]         = std::vector<Double_t>();
-            _candidate_vars[prefix + "_TAG_e2_IP2D"]         = std::vector<Double_t>();
-
-            // _candidate_vars[prefix + "_TAG_e2_EhadOverEM"] =
-            // std::vector<Double_t>();
+            _candidate_vars[prefix + "_TAG_jet_charge_05"]   = kFloat;
+            _candidate_vars[prefix + "_TAG_sIP3DTagger"]     = kBool;
+            _candidate_vars[prefix + "_TAG_kTagger"]         = kBool;
+            _candidate_vars[prefix + "_TAG_CharmIPXDTagger"] = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_d0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_d0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_z0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_z0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t1_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_d0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_d0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_z0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_z0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t2_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_d0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_d0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_z0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_z0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t3_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_d0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_d0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_z0"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_z0err"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_t4_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_k1_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_k1_q"]            = kInt16;
+            _candidate_vars[prefix + "_TAG_k1_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_k1_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_k1_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_k2_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_k2_q"]            = kInt16;
+            _candidate_vars[prefix + "_TAG_k2_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_k2_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_k2_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_e1_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_e1_q"]            = kInt16;
+            _candidate_vars[prefix + "_TAG_e1_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_e1_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_e1_IP2D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_e2_PT"]           = kFloat;
+            _candidate_vars[prefix + "_TAG_e2_q"]            = kInt16;
+            _candidate_vars[prefix + "_TAG_e2_sIP3D"]        = kFloat;
+            _candidate_vars[prefix + "_TAG_e2_IP3D"]         = kFloat;
+            _candidate_vars[prefix + "_TAG_e2_IP2D"]         = kFloat;
+
+            // Book the tagger now rather than on the first jet, while
+            // initialization is still serialized across threads
+            _jet_tagger = JetTaggingTool::getInstance(getData());
+            _jet_tagger->initialize(store);
+            _tagged_lists.push_back(list_handles[listName]);
+
+            // _candidate_vars[prefix + "_TAG_e2_EhadOverEM"] = kFloat;
           }
         }
       }
@@ -150,19 +186,111 @@ void TreeWriterModule::initialize()
     }
 
 
-    std::map<TString, Double_t>::iterator itg = _global_vars.begin();
+    // Per-block storage type overrides, e.g.
+    //   add types {Jet} {FiducialJet} {TAG_kTagger float KIN_PT double}
+    // The variable "*" stands for every variable of the block.
+    ExRootConfParam t = getConfiguration()->GetParam(Form("%s::types", getName().c_str()));
+
+    for (Int_t i = 0; i < t.GetSize(); i = i + 3) {
+      TString blockName = t[i].GetString();
+      TString listName  = t[i + 1].GetString();
+      TString prefix    = (listName == "") ? blockName : blockName + "_" + listName;
+      auto&   vars      = (listName == "") ? _global_vars : _candidate_vars;
+
+      TObjArray *tokens = TString(t[i + 2].GetString()).Tokenize(" ");
+
+      if (tokens->GetEntries() % 2 != 0) {
+        std::stringstream message;
+        message << "Storage types of block " << prefix.Data() << " must be given as pairs of variable and type! [" << getName() << "::TreeWriterModule]" << std::endl;
+        throw std::runtime_error(message.str());
+      }
+
+      for (Int_t k = 0; k < tokens->GetEntries(); k = k + 2) {
+        TString     varName = static_cast<TObjString *>(tokens->At(k))->GetString();
+        StorageType type    = storageType(static_cast<TObjString *>(tokens->At(k + 1))->GetString());
+        Int_t       matched = 0;
+
+        for (auto& var : vars) {
+          if ((varName == "*") ? var.first.BeginsWith(prefix + "_") : (var.first == prefix + "_" + varName)) {
+            var.second = type;
+            matched++;
+          }
+        }
+
+        if (matched == 0) {
+          std::stringstream message;
+          message << "No output variable " << prefix.Data() << "_" << varName.Data() << " to set the storage type of! [" << getName() << "::TreeWriterModule]" << std::endl;
+          throw std::runtime_error(message.str());
+        }
+      }
+
+      delete tokens;
+    }
+
+
+    std::map<TString, GlobalVariable> global_suffixes = {
+      { "_MET_ET", kMET_ET }, { "_MET_Phi", kMET_Phi }, { "_BJx", kBJx }, { "_BJy", kBJy },
+      { "_BJQ2", kBJQ2 }, { "_JBx", kJBx }, { "_JBQ2", kJBQ2 }
+    };
 
-    while (itg != _global_vars.end()) {
-      tree_handler->getTree()->Branch(itg->first, &(itg->second), Form("%s/D", itg->first.Data()));
-      itg++;
+    // The branches hold the addresses of the elements
+    _globals.reserve(_global_vars.size());
+
+    for (auto var : _global_vars) {
+      for (auto suffix : global_suffixes) {
+        if (!var.first.EndsWith(suffix.first)) continue;
+
+        Global global;
+
+        global.variable = suffix.second;
+        global.type     = var.second;
+        _globals.push_back(global);
+
+        Global     *g    = &_globals.back();
+        const char *name = var.first.Data();
+
+        switch (g->type) {
+          case kDouble: tree_handler->branch(name, &g->d, Form("%s/D", name)); break;
+          case kFloat:  tree_handler->branch(name, &g->f, Form("%s/F", name)); break;
+          case kInt32:  tree_handler->branch(name, &g->i, Form("%s/I", name)); break;
+          case kInt16:  tree_handler->branch(name, &g->s, Form("%s/S", name)); break;
+          case kBool:   tree_handler->branch(name, &g->b, Form("%s/O", name)); break;
+        }
+      }
     }
 
 
-    std::map<TString, std::vector<Double_t> >::iterator itc = _candidate_vars.begin();
+    _columns.reserve(_candidate_vars.size());
 
-    while (itc != _candidate_vars.end()) {
-      tree_handler->getTree()->Branch(itc->first, "std::vector<Double_t>", &(itc->second));
-      itc++;
+    for (auto var : _candidate_vars) {
+      // Parse the key (block_list_GROUP_variable) once
+      TObjArray *key_parts = var.first.Tokenize("_");
+      Column     column;
+
+      column.name  = var.first;
+      column.type  = var.second;
+      column.list  = list_handles[static_cast<TObjString *>(key_parts->At(1))->GetString()];
+      column.group = static_cast<TObjString *>(key_parts->At(2))->GetString();
+
+      for (Int_t k = 3; k < key_parts->GetEntries(); k++) {
+        if (k > 3) column.variable += "_";
+        column.variable += static_cast<TObjString *>(key_parts->At(k))->GetString();
+      }
+
+      if (key_parts) delete key_parts;
+
+      _columns.push_back(column);
+
+      Column     *c    = &_columns.back();
+      const char *name = c->name.Data();
+
+      switch (c->type) {
+        case kDouble: tree_handler->branch(name, "std::vector<Double_t>", &c->d); break;
+        case kFloat:  tree_handler->branch(name, "std::vector<Float_t>", &c->f);  break;
+        case kInt32:  tree_handler->branch(name, "std::vector<Int_t>", &c->i);    break;
+        case kInt16:  tree_handler->branch(name, "std::vector<Short_t>", &c->s);  break;
+        case kBool:   tree_handler->branch(name, "std::vector<Bool_t>", &c->b);   break;
+      }
     }
 
 
@@ -173,108 +301,80 @@ void TreeWriterModule::initialize()
 void TreeWriterModule::finalize()
 {}
 
-bool TreeWriterModule::execute(std::map<std::string, std::any> *DataStore)
+bool TreeWriterModule::execute(DataStore *store)
 {
-  // Clear any caches
-  _cache_emfrac.clear();
-
-  // Proceed to process the event
-
-  auto data = getData();
-
   // Compute global DIS variables
-  auto dis_variables = DISVariables(getGenParticles());
-  auto jb_variables  = DISJacquetBlondel(getEFlowTracks(), getElectrons(), getPhotons(), getNeutralHadrons());
+  std::map<std::string, float> dis_variables;
+  std::map<std::string, float> jb_variables;
+
+  if (_particle_handle.isValid() && (_eflowtrack_soa != nullptr)) {
+    dis_variables = DISVariables(store->get(_particle_handle));
+    jb_variables  = DISJacquetBlondel(_eflowtrack_soa->columns(),
+                                      _photon_soa->columns(),
+                                      _neutralhadron_soa->columns());
+  }
 
 
   // Get the MET object
   MissingET *MET = nullptr;
 
-  for (int imet = 0; imet < getMET()->GetEntries(); imet++) {
-    MET = static_cast<MissingET *>(getMET()->At(imet));
-  }
+  if (_met_handle.isValid()) {
+    TObjArray *METList = store->get(_met_handle);
 
-  std::map<TString, Double_t>::iterator itg = _global_vars.begin();
-
-  while (itg != _global_vars.end()) {
-    if (itg->first.Contains("MET_ET")) {
-      itg->second = MET->MET;
-    } else if (itg->first.Contains("MET_Phi")) {
-      itg->second = MET->Phi;
-    } else if (itg->first.Contains("BJx")) {
-      itg->second = dis_variables["x"];
-    } else if (itg->first.Contains("BJy")) {
-      itg->second = dis_variables["y"];
-    } else if (itg->first.Contains("BJQ2")) {
-      itg->second = dis_variables["Q2"];
-    } else if (itg->first.Contains("JBx")) {
-      itg->second = jb_variables["x_JB"];
-    } else if (itg->first.Contains("JBQ2")) {
-      itg->second = jb_variables["Q2_JB"];
+    for (int imet = 0; imet < METList->GetEntries(); imet++) {
+      MET = static_cast<MissingET *>(METList->At(imet));
     }
-
-    itg++;
   }
 
+  for (auto& global : _globals) {
+    switch (global.variable) {
+      case kMET_ET:  setGlobal(global, MET->MET);              break;
+      case kMET_Phi: setGlobal(global, MET->Phi);              break;
+      case kBJx:     setGlobal(global, dis_variables["x"]);    break;
+      case kBJy:     setGlobal(global, dis_variables["y"]);    break;
+      case kBJQ2:    setGlobal(global, dis_variables["Q2"]);   break;
+      case kJBx:     setGlobal(global, jb_variables["x_JB"]);  break;
+      case kJBQ2:    setGlobal(global, jb_variables["Q2_JB"]); break;
+    }
+  }
 
-  std::map<TString, std::vector<Double_t> >::iterator itc = _candidate_vars.begin();
 
-  while (itc != _candidate_vars.end()) {
-    // clear out any old data
-    itc->second.clear();
+  // Tag the jets of each list at once, so that the tagger network is
+  // evaluated for all of them in one batch
+  for (auto handle : _tagged_lists) {
+    TObjArray *jets = store->get(handle);
 
-    TString key          = itc->first;
-    TObjArray *key_parts = key.Tokenize("_");
+    if ((jets != nullptr) && (jets->GetEntriesFast() > 0) && (jets->At(0)->IsA() == Jet::Class())) {
+      _jet_tagger->execute(jets, store);
+    }
+  }
 
-    TString listName = static_cast<TObjString *>(key_parts->At(1))->GetString();
 
-    if (key_parts) delete key_parts;
+  for (auto& column : _columns) {
+    // clear out any old data
+    column.d.clear();
+    column.f.clear();
+    column.i.clear();
+    column.s.clear();
+    column.b.clear();
 
     // Load the list from the DataStore
-    TObjArray *candidateList = nullptr;
-
-    if (DataStore->find(listName.Data()) != DataStore->end()) {
-      try {
-        candidateList = std::any_cast<TObjArray *>((*DataStore)[listName.Data()]);
-      } catch (const std::bad_any_cast& e)
-      {
-        try {
-          candidateList = std::any_cast<TClonesArray *>((*DataStore)[listName.Data()]);
-        } catch (const std::bad_any_cast& e)
-        {
-          std::stringstream message;
-          message << "Input list " << listName.Data()
-                  << " must be either TObjArray or TClonesArray! [" << getName() << "::TreeWriterModule]" << std::endl;
-          throw std::runtime_error(message.str());
-        }
-      }
-    } else {
-      std::stringstream message;
-      message << "List " << listName.Data()
-              << " does not exist in the DataStore! [" << getName() << "::TreeWriterModule]" << std::endl;
-      throw std::runtime_error(message.str());
-    }
+    TObjArray *candidateList = store->get(column.list);
 
-    if (candidateList != nullptr) {
-      for (Int_t c = 0; c < candidateList->GetEntries(); c++) {
-        auto candidate = candidateList->At(c);
-
-        if (itc->first.Contains("_KIN_")) {
-          itc->second.push_back(kinVar(itc->first, candidate));
-        } else if (itc->first.Contains("_CALO_")) {
-          itc->second.push_back(caloVar(itc->first, candidate, DataStore));
-        } else if (itc->first.Contains("_TRU_")) {
-          itc->second.push_back(truthVar(itc->first, candidate, DataStore));
-        } else if (itc->first.Contains("_TAG_")) {
-          itc->second.push_back(jetTagging(itc->first, candidate, DataStore));
-        } else if (itc->first.Contains("_PID_")) {
-          itc->second.push_back(pidVar(itc->first, candidate, DataStore));
-        }
-      }
-    }
+    if (candidateList == nullptr) continue;
 
+    if ((candidateList->GetEntriesFast() > 0) && !column.accessor) {
+      column.accessor = bindAccessor(column.group, column.variable, candidateList->At(0)->IsA()->GetName());
+    }
 
-    itc++;
+    // One switch on the declared type per column, not per candidate
+    switch (column.type) {
+      case kDouble: fill(column.d, column.accessor, candidateList, store); break;
+      case kFloat:  fill(column.f, column.accessor, candidateList, store); break;
+      case kInt32:  fill(column.i, column.accessor, candidateList, store); break;
+      case kInt16:  fill(column.s, column.accessor, candidateList, store); break;
+      case kBool:   fill(column.b, column.accessor, candidateList, store); break;
+    }
   }
 
 
@@ -9,6 +9,12 @@
 #include <iomanip>
 #include <fstream>
 #include <algorithm>
+#include <functional>
+#include <limits>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
 
 // ROOT includes
 #include "TString.h"
@@ -24,6 +30,9 @@
 
 // Other includes
 #include "Module.h"
+#include "CaloAssociation.h"
+#include "DeltaRMatcher.h"
+#include "EventSoA.h"
 #include "AnalysisFunctions.cc"
 #include "classes/DelphesClasses.h"
 #include "JetTaggingTool.h"
@@ -38,7 +47,7 @@ public:
   ~TreeWriterModule();
 
   void initialize() override;
-  bool execute(std::map<std::string, std::any> *DataStore) override;
+  bool execute(DataStore *store) override;
   void finalize() override;
 
 private:
@@ -59,552 +68,327 @@ private:
   Double_t _mp;
 
 
-  std::map<TString, Double_t>_global_vars;
-  std::map<TString, std::vector<Double_t> >_candidate_vars;
+  // Storage type of an output variable in the tree
+  enum StorageType { kDouble, kFloat, kInt32, kInt16, kBool };
+
+  // Declared storage type of every output variable, by branch name
+  std::map<TString, StorageType>_global_vars;
+  std::map<TString, StorageType>_candidate_vars;
+
+  // Computes one candidate-level value
+  typedef std::function<Double_t(TObject *, DataStore *)> Accessor;
+
+  // Event-level variables, resolved at initialize. Only the member of the
+  // declared type is branched and filled.
+  enum GlobalVariable { kMET_ET, kMET_Phi, kBJx, kBJy, kBJQ2, kJBx, kJBQ2 };
+  struct Global {
+    GlobalVariable variable;
+    StorageType    type;
+    Double_t       d = 0.0;
+    Float_t        f = 0.0;
+    Int_t          i = 0;
+    Short_t        s = 0;
+    Bool_t         b = kFALSE;
+  };
+  std::vector<Global>_globals;
+
+  // One output column per entry of _candidate_vars, parsed at initialize.
+  // The accessor depends on the class of the list's candidates and is bound
+  // the first time the list is not empty. Only the vector of the declared
+  // type is branched and filled.
+  struct Column {
+    TString                      name;
+    StorageType                  type;
+    DataStore::Handle<TObjArray> list;
+    TString                      group;
+    TString                      variable;
+    Accessor                     accessor;
+    std::vector<Double_t>        d;
+    std::vector<Float_t>         f;
+    std::vector<Int_t>           i;
+    std::vector<Short_t>         s;
+    std::vector<Bool_t>          b;
+  };
+  std::vector<Column>_columns;
+
+  // DataStore inputs, resolved only for the blocks that need them
+  DataStore::Handle<TObjArray>_met_handle;
+  DataStore::Handle<TObjArray>_particle_handle;
+  EventSoA *_eflowtrack_soa    = nullptr;
+  EventSoA *_photon_soa        = nullptr;
+  EventSoA *_neutralhadron_soa = nullptr;
+  CaloAssociation *_calo = nullptr;
+  DeltaRMatcher *_genjet_match   = nullptr;
+  DeltaRMatcher *_particle_match = nullptr;
+  DataStore::Handle<EMFractionMap>_emfrac_handle;
+
+  // Lists written with a JetTagging block, and their tagger
+  std::vector<DataStore::Handle<TObjArray> >_tagged_lists;
+  JetTaggingTool *_jet_tagger = nullptr;
 
 
-  // Internal correction of calorimeter energy distribution based on Full
-  // Simulation
-  std::map<SortableObject *, Double_t>_cache_emfrac;
   TFile *_emfrac_file = nullptr;
 
 private:
 
   // Private methods
-  Double_t kinVar(TString varName, TObject *obj) {
-    if (obj->InheritsFrom("Jet")) {
-      auto p = static_cast<Jet *>(obj);
-
-      if (varName.Contains("_PT")) {
-        return p->PT;
-      } else if (varName.Contains("_Eta")) {
-        return p->Eta;
-      } else if (varName.Contains("_Phi")) {
-        return p->Phi;
-      } else if (varName.Contains("_M")) {
-        return p->Mass;
-      }
-    } else if (obj->InheritsFrom("Track")) {
-      auto p = static_cast<Track *>(obj);
-
-      if (varName.Contains("_PT")) {
-        return p->PT;
-      } else if (varName.Contains("_Eta")) {
-        return p->Eta;
-      } else if (varName.Contains("_Phi")) {
-        return p->Phi;
-      } else if (varName.Contains("_M")) {
-        return p->Mass;
-      }
-    } else if (obj->InheritsFrom("Electron")) {
-      auto p = static_cast<Electron *>(obj);
-
-      if (varName.Contains("_PT")) {
-        return p->PT;
-      } else if (varName.Contains("_Eta")) {
-        return p->Eta;
-      } else if (varName.Contains("_Phi")) {
-        return p->Phi;
-      } else if (varName.Contains("_M")) {
-        return _me;
-      }
-    } else if (obj->InheritsFrom("Muon")) {
-      auto p = static_cast<Muon *>(obj);
-
-      if (varName.Contains("_PT")) {
-        return p->PT;
-      } else if (varName.Contains("_Eta")) {
-        return p->Eta;
-      } else if (varName.Contains("_Phi")) {
-        return p->Phi;
-      } else if (varName.Contains("_M")) {
-        return _mmu;
-      }
-    }
-    return 0.0;
-  }
 
-  Double_t pidVar(TString varName, TObject *obj, std::map<std::string, std::any> *DataStore) {
-    if (varName.Contains("_ID")) {
-      if (obj->InheritsFrom("Jet")) {
-        // Not defined for a jet
-        return 0;
-      } else if (obj->InheritsFrom("Track")) {
-        auto p = static_cast<Track *>(obj);
-        return p->PID;
-      } else if (obj->InheritsFrom("Electron")) {
-        auto p = static_cast<Electron *>(obj);
-        return -11 * p->Charge;
-      } else if (obj->InheritsFrom("Muon")) {
-        auto p = static_cast<Track *>(obj);
-        return -13 * p->Charge;
-      }
-      return 0.0;
+  // Leaves of a candidate list read by one variable block, from the Delphes
+  // class of the list; for an unknown class, or for blocks that read more
+  // than a few members, all leaves are read.
+  std::vector<std::string>candidateLeaves(TString className, TString varName) {
+    if (varName == "Kinematics") {
+      if ((className == "Jet") || (className == "Track")) return { "PT", "Eta", "Phi", "Mass" };
+      if ((className == "Electron") || (className == "Muon")) return { "PT", "Eta", "Phi" };
+    } else if (varName == "PID") {
+      if (className == "Jet") return { "PT" };
+      if (className == "Track") return { "PID" };
+      if ((className == "Electron") || (className == "Muon")) return { "Charge" };
+    } else if (varName == "Truth") {
+      if (className == "Jet") return { "Flavor", "PT", "Eta", "Phi", "Mass" };
+      if (className == "Track") return { "PT", "Eta", "Phi", "Mass", "Charge", "Particle" };
+      if (className == "Electron") return { "Particle" };
+      if (className == "Muon") return { "Charge", "Particle" };
+    } else if (varName == "Calorimeter") {
+      if (className == "Electron") return { "Particle" };
+      if ((className == "Jet") || (className == "Track") || (className == "Muon")) return { "PT" };
     }
-    return 0.0;
+    return {};
   }
 
-  Double_t truthVar(TString varName, TObject *obj, std::map<std::string, std::any> *DataStore) {
-    if (varName.Contains("_ID")) {
-      if (obj->InheritsFrom("Jet")) {
-        auto p = static_cast<Jet *>(obj);
-        return p->Flavor;
-      } else if (obj->InheritsFrom("Track")) {
-        auto p = static_cast<Track *>(obj);
-
-        GenParticle *original = dynamic_cast<GenParticle *>(p->Particle.GetObject());
-
-        if (original) {
-          return original->PID;
-        }
-
-        return 0.0;
-      } else if (obj->InheritsFrom("Electron")) {
-        auto p = static_cast<Electron *>(obj);
+  StorageType storageType(TString name) {
+    static const std::map<TString, StorageType> types = {
+      { "double", kDouble }, { "float", kFloat }, { "int32", kInt32 }, { "int16", kInt16 }, { "bool", kBool }
+    };
 
-        // Obtain truth from the GenParticle reference
+    auto type = types.find(name);
 
-        /* return -11*p->Charge; */
-        if (p->Particle.GetObject() != nullptr) return static_cast<Candidate *>(p->Particle.GetObject())->PID;
-        return 0.0;
-      } else if (obj->InheritsFrom("Muon")) {
-        auto p = static_cast<Track *>(obj);
-        return -13 * p->Charge;
-      }
-      return 0.0;
-    } else if (varName.Contains("_PT")) {
-      if (obj->InheritsFrom("Jet")) {
-        auto p = static_cast<Jet *>(obj);
-
-        // match to a truth jet
-        auto truthjets    = std::any_cast<TClonesArray *>((*DataStore)["GenJet"]);
-        Double_t minDR    = 1e99;
-        Jet     *truthJet = nullptr;
-
-        for (Int_t tj = 0; tj < truthjets->GetEntries(); tj++) {
-          Jet *genJet = static_cast<Jet *>(truthjets->At(tj));
-          Double_t dR = genJet->P4().DeltaR(p->P4());
-
-          if ((dR < 0.5) && (dR < minDR)) {
-            minDR    = dR;
-            truthJet = genJet;
-          }
-        }
+    if (type == types.end()) {
+      std::stringstream message;
+      message << "Unknown storage type " << name.Data() << "; use double, float, int32, int16 or bool [" << getName() << "::TreeWriterModule]" << std::endl;
+      throw std::runtime_error(message.str());
+    }
+    return type->second;
+  }
 
-        if (truthJet != nullptr)
-          return truthJet->PT;
-        return 0.0;
-      } else if (obj->InheritsFrom("Track")) {
-        auto p = dynamic_cast<Track *>(obj);
+  // A value in a storage type: integers are rounded and clamped to the
+  // range of the type, and are 0 for NaN or infinity
+  template <class T>
+  static T narrow(Double_t value) {
+    if (std::is_same<T, Bool_t>::value) return value != 0.0;
+    if (std::is_floating_point<T>::value) return T(value);
+    if (!std::isfinite(value)) return T(0);
 
-        TClonesArray *TruthParticles = std::any_cast<TClonesArray *>((*DataStore)["Particle"]);
-        Double_t minDR               = 1e99;
-        GenParticle *truthparticle   = nullptr;
+    Double_t low  = std::numeric_limits<T>::lowest();
+    Double_t high = std::numeric_limits<T>::max();
 
-        for (Int_t tp = 0; tp < TruthParticles->GetEntries(); tp++) {
-          GenParticle *a_particle = static_cast<GenParticle *>(TruthParticles->At(tp));
+    return T(std::max(low, std::min(high, std::round(value))));
+  }
 
-          Double_t dR = a_particle->P4().DeltaR(p->P4());
+  void setGlobal(Global& global, Double_t value) {
+    switch (global.type) {
+      case kDouble: global.d = value;                  break;
+      case kFloat:  global.f = narrow<Float_t>(value); break;
+      case kInt32:  global.i = narrow<Int_t>(value);   break;
+      case kInt16:  global.s = narrow<Short_t>(value); break;
+      case kBool:   global.b = narrow<Bool_t>(value);  break;
+    }
+  }
 
-          if ((a_particle->Charge == p->Charge) && (dR < minDR)) {
-            minDR         = dR;
-            truthparticle = a_particle;
-          }
-        }
+  template <class T>
+  static void fill(std::vector<T>& values, const Accessor& accessor, TObjArray *list, DataStore *store) {
+    Int_t n_candidates = list->GetEntriesFast();
 
-        // std::cout << truthparticle << std::endl;
-        if (truthparticle != nullptr)
-          return truthparticle->PT;
-        return -999.0;
-      } else if (obj->InheritsFrom("Electron")) {
-        auto p = static_cast<Electron *>(obj);
-
-        auto truthparticle = static_cast<GenParticle *>(p->Particle.GetObject());
-
-        if (truthparticle != nullptr)
-          return truthparticle->PT;
-        return -999.0;
-      } else if (obj->InheritsFrom("Muon")) {
-        auto p             = static_cast<Track *>(obj);
-        auto truthparticle = static_cast<GenParticle *>(p->Particle.GetObject());
-
-        if (truthparticle != nullptr)
-          return truthparticle->PT;
-        return -999.0;
-      }
-      return 0.0;
-    } else if (varName.Contains("_Eta")) {
-      if (obj->InheritsFrom("Jet")) {
-        auto p = static_cast<Jet *>(obj);
-
-        // match to a truth jet
-        auto truthjets    = std::any_cast<TClonesArray *>((*DataStore)["GenJet"]);
-        Double_t minDR    = 1e99;
-        Jet     *truthJet = nullptr;
-
-        for (Int_t tj = 0; tj < truthjets->GetEntries(); tj++) {
-          Jet *genJet = static_cast<Jet *>(truthjets->At(tj));
-          Double_t dR = genJet->P4().DeltaR(p->P4());
-
-          if ((dR < 0.5) && (dR < minDR)) {
-            minDR    = dR;
-            truthJet = genJet;
-          }
-        }
-
-        if (truthJet != nullptr)
-          return truthJet->Eta;
-        return 0.0;
-      } else if (obj->InheritsFrom("Track")) {
-        auto p             = static_cast<Track *>(obj);
-        auto truthparticle = static_cast<GenParticle *>(p->Particle.GetObject());
-
-        if (truthparticle != nullptr)
-          return truthparticle->Eta;
-        return -999.0;
-      } else if (obj->InheritsFrom("Electron")) {
-        auto p = static_cast<Electron *>(obj);
-
-        auto truthparticle = static_cast<GenParticle *>(p->Particle.GetObject());
-
-        if (truthparticle != nullptr)
-          return truthparticle->Eta;
-        return -999.0;
-      } else if (obj->InheritsFrom("Muon")) {
-        auto p             = static_cast<Track *>(obj);
-        auto truthparticle = static_cast<GenParticle *>(p->Particle.GetObject());
-
-        if (truthparticle != nullptr)
-          return truthparticle->Eta;
-        return -999.0;
-      }
-      return 0.0;
+    for (Int_t c = 0; c < n_candidates; c++) {
+      values.push_back(narrow<T>(accessor(list->At(c), store)));
     }
-
-    return 0.0;
   }
 
-  Double_t caloVar(TString varName, TObject *obj, std::map<std::string, std::any> *DataStore) {
-    if (obj->InheritsFrom("Electron")) {
-      auto p = static_cast<Electron *>(obj);
+  // Typed accessors, bound once per output column
 
-      // Check if this particl has already been calorimeter-corrected
-      Double_t emfrac = -1.0;
+  template <class T, class M>
+  static Accessor member(M T::*field) {
+    return [field](TObject *obj, DataStore *) {
+             return Double_t(static_cast<T *>(obj)->*field);
+           };
+  }
 
-      // Retrieve the full-sim corrected EM fraction map
-      auto EMFracMap = std::any_cast<std::map<TObject *, Double_t> *>((*DataStore)["EMFracMap"]);
+  static Accessor constant(Double_t value) {
+    return [value](TObject *, DataStore *) {
+             return value;
+           };
+  }
 
-      // See if this track is in the map.
-      if (EMFracMap->find(p->Particle.GetObject()) != EMFracMap->end()) {
-        emfrac = (*EMFracMap)[p->Particle.GetObject()];
-      }
+  template <class T>
+  static GenParticle* truthParticle(TObject *obj) {
+    return static_cast<GenParticle *>(static_cast<T *>(obj)->Particle.GetObject());
+  }
 
-      if (varName.Contains("_Eem")) {
-        auto CaloTower = std::any_cast<TClonesArray *>((*DataStore)["Tower"]);
-        Double_t CaloE = 0.0;
-        Double_t CaloH = 0.0;
+  template <class T>
+  Accessor kinematics(TString variable, Accessor mass) {
+    if (variable == "PT") return member(&T::PT);
+    if (variable == "Eta") return member(&T::Eta);
+    if (variable == "Phi") return member(&T::Phi);
+    if (variable == "M") return mass;
+    return constant(0.0);
+  }
 
-        std::vector<Tower *> track_towers;
+  // Truth PT or Eta through the GenParticle reference
+  template <class T>
+  Accessor truthReference(TString variable) {
+    if (variable == "PT") {
+      return [](TObject *obj, DataStore *) {
+               GenParticle *particle = truthParticle<T>(obj);
+               return (particle != nullptr) ? Double_t(particle->PT) : -999.0;
+             };
+    }
+    if (variable == "Eta") {
+      return [](TObject *obj, DataStore *) {
+               GenParticle *particle = truthParticle<T>(obj);
+               return (particle != nullptr) ? Double_t(particle->Eta) : -999.0;
+             };
+    }
+    return constant(0.0);
+  }
 
-        for (Int_t t = 0; t < CaloTower->GetEntries(); t++) {
-          auto calotower       = static_cast<Tower *>(CaloTower->At(t));
-          auto tower_particles = calotower->Particles;
+  // Calorimeter energy of the towers matched to an electron's particle,
+  // split by the full-simulation EM fraction
+  Double_t electronCalo(Electron *p, DataStore *store, Bool_t em) {
+    // Retrieve the full-sim corrected EM fraction map
+    auto EMFracMap  = store->get(_emfrac_handle);
+    Double_t emfrac = -1.0;
 
-          for (Int_t ref = 0; ref < tower_particles.GetEntries(); ref++) {
-            TRef calo_ref     = tower_particles.At(ref);
-            TObject *calo_obj = calo_ref.GetObject();
+    // See if this track is in the map.
+    if (EMFracMap->find(p->Particle.GetObject()) != EMFracMap->end()) {
+      emfrac = (*EMFracMap)[p->Particle.GetObject()];
+    }
 
-            if ((p->Particle.GetObject() == nullptr) || (calo_obj == nullptr)) continue;
+    TObject *particle  = p->Particle.GetObject();
+    Double_t CaloTotal = _calo->Eem(particle) + _calo->Ehad(particle);
 
-            if (p->Particle.GetObject() == calo_ref.GetObject()) {
-              track_towers.push_back(calotower);
-            }
-          }
-        }
+    return em ? CaloTotal * emfrac : CaloTotal * (1.0 - emfrac);
+  }
 
+  // JetTaggingInfo field for each TAG variable name
+  static Double_t JetTaggingInfo::* taggingField(TString variable) {
+    static const std::map<TString, Double_t JetTaggingInfo::*> fields = {
+      { "jet_charge_05", &JetTaggingInfo::jet_charge_05 }, { "sIP3DTagger", &JetTaggingInfo::sIP3DTagged },
+      { "kTagger", &JetTaggingInfo::kTagged }, { "CharmIPXDTagger", &JetTaggingInfo::CharmIPXDTagger },
+      { "t1_PT", &JetTaggingInfo::t1_pt }, { "t1_d0", &JetTaggingInfo::t1_d0 }, { "t1_d0err", &JetTaggingInfo::t1_d0err },
+      { "t1_z0", &JetTaggingInfo::t1_z0 }, { "t1_z0err", &JetTaggingInfo::t1_z0err }, { "t1_sIP3D", &JetTaggingInfo::t1_sIP3D },
+      { "t1_IP3D", &JetTaggingInfo::t1_IP3D }, { "t1_IP2D", &JetTaggingInfo::t1_IP2D },
+      { "t2_PT", &JetTaggingInfo::t2_pt }, { "t2_d0", &JetTaggingInfo::t2_d0 }, { "t2_d0err", &JetTaggingInfo::t2_d0err },
+      { "t2_z0", &JetTaggingInfo::t2_z0 }, { "t2_z0err", &JetTaggingInfo::t2_z0err }, { "t2_sIP3D", &JetTaggingInfo::t2_sIP3D },
+      { "t2_IP3D", &JetTaggingInfo::t2_IP3D }, { "t2_IP2D", &JetTaggingInfo::t2_IP2D },
+      { "t3_PT", &JetTaggingInfo::t3_pt }, { "t3_d0", &JetTaggingInfo::t3_d0 }, { "t3_d0err", &JetTaggingInfo::t3_d0err },
+      { "t3_z0", &JetTaggingInfo::t3_z0 }, { "t3_z0err", &JetTaggingInfo::t3_z0err }, { "t3_sIP3D", &JetTaggingInfo::t3_sIP3D },
+      { "t3_IP3D", &JetTaggingInfo::t3_IP3D }, { "t3_IP2D", &JetTaggingInfo::t3_IP2D },
+      { "t4_PT", &JetTaggingInfo::t4_pt }, { "t4_d0", &JetTaggingInfo::t4_d0 }, { "t4_d0err", &JetTaggingInfo::t4_d0err },
+      { "t4_z0", &JetTaggingInfo::t4_z0 }, { "t4_z0err", &JetTaggingInfo::t4_z0err }, { "t4_sIP3D", &JetTaggingInfo::t4_sIP3D },
+      { "t4_IP3D", &JetTaggingInfo::t4_IP3D }, { "t4_IP2D", &JetTaggingInfo::t4_IP2D },
+      { "k1_PT", &JetTaggingInfo::k1_pt }, { "k1_q", &JetTaggingInfo::k1_q }, { "k1_sIP3D", &JetTaggingInfo::k1_sIP3D },
+      { "k1_IP3D", &JetTaggingInfo::k1_IP3D }, { "k1_IP2D", &JetTaggingInfo::k1_IP2D },
+      { "k2_PT", &JetTaggingInfo::k2_pt }, { "k2_q", &JetTaggingInfo::k2_q }, { "k2_sIP3D", &JetTaggingInfo::k2_sIP3D },
+      { "k2_IP3D", &JetTaggingInfo::k2_IP3D }, { "k2_IP2D", &JetTaggingInfo::k2_IP2D },
+      { "e1_PT", &JetTaggingInfo::e1_pt }, { "e1_q", &JetTaggingInfo::e1_q }, { "e1_sIP3D", &JetTaggingInfo::e1_sIP3D },
+      { "e1_IP3D", &JetTaggingInfo::e1_IP3D }, { "e1_IP2D", &JetTaggingInfo::e1_IP2D },
+      { "e2_PT", &JetTaggingInfo::e2_pt }, { "e2_q", &JetTaggingInfo::e2_q }, { "e2_sIP3D", &JetTaggingInfo::e2_sIP3D },
+      { "e2_IP3D", &JetTaggingInfo::e2_IP3D }, { "e2_IP2D", &JetTaggingInfo::e2_IP2D }
+    };
+
+    auto field = fields.find(variable);
+
+    return (field != fields.end()) ? field->second : nullptr;
+  }
 
-        for (auto track_tower : track_towers) {
-          CaloE += track_tower->Eem;
-          CaloH += track_tower->Ehad;
+  // Resolve the accessor of one column for the concrete class of its list.
+  // Combinations that are not defined yield 0, as for unknown classes.
+  Accessor bindAccessor(TString group, TString variable, TString type) {
+    if (group == "KIN") {
+      if (type == "Jet") return kinematics<Jet>(variable, member(&Jet::Mass));
+      if (type == "Track") return kinematics<Track>(variable, member(&Track::Mass));
+      if (type == "Electron") return kinematics<Electron>(variable, constant(_me));
+      if (type == "Muon") return kinematics<Muon>(variable, constant(_mmu));
+    } else if (group == "PID") {
+      if (variable != "ID") return constant(0.0);
+      if (type == "Track") return member(&Track::PID);
+      if (type == "Electron") {
+        return [](TObject *obj, DataStore *) {
+                 return -11.0 * static_cast<Electron *>(obj)->Charge;
+               };
+      }
+      if (type == "Muon") {
+        return [](TObject *obj, DataStore *) {
+                 return -13.0 * static_cast<Muon *>(obj)->Charge;
+               };
+      }
+    } else if (group == "TRU") {
+      if (type == "Jet") {
+        if (variable == "ID") return member(&Jet::Flavor);
+        if (variable == "PT") {
+          return [this](TObject *obj, DataStore *store) {
+                   auto truthJet = static_cast<Jet *>(_genjet_match->best(obj));
+                   return (truthJet != nullptr) ? Double_t(truthJet->PT) : 0.0;
+                 };
         }
-
-        Double_t CaloTotal = CaloE + CaloH;
-
-        return CaloTotal * emfrac;
-      }
-
-      if (varName.Contains("_Ehad")) {
-        auto CaloTower = std::any_cast<TClonesArray *>((*DataStore)["Tower"]);
-        Double_t CaloE = 0.0;
-        Double_t CaloH = 0.0;
-
-        std::vector<Tower *> track_towers;
-
-        for (Int_t t = 0; t < CaloTower->GetEntries(); t++) {
-          auto calotower       = static_cast<Tower *>(CaloTower->At(t));
-          auto tower_particles = calotower->Particles;
-
-          for (Int_t ref = 0; ref < tower_particles.GetEntries(); ref++) {
-            TRef calo_ref     = tower_particles.At(ref);
-            TObject *calo_obj = calo_ref.GetObject();
-
-            if ((p->Particle.GetObject() == nullptr) || (calo_obj == nullptr)) continue;
-
-            if (p->Particle.GetObject() == calo_ref.GetObject()) {
-              track_towers.push_back(calotower);
-            }
-          }
+        if (variable == "Eta") {
+          return [this](TObject *obj, DataStore *store) {
+                   auto truthJet = static_cast<Jet *>(_genjet_match->best(obj));
+                   return (truthJet != nullptr) ? Double_t(truthJet->Eta) : 0.0;
+                 };
         }
-
-
-        for (auto track_tower : track_towers) {
-          CaloE += track_tower->Eem;
-          CaloH += track_tower->Ehad;
+      } else if (type == "Track") {
+        if (variable == "ID") {
+          return [](TObject *obj, DataStore *) {
+                   GenParticle *original = truthParticle<Track>(obj);
+                   return (original != nullptr) ? Double_t(original->PID) : 0.0;
+                 };
         }
-
-
-        Double_t CaloTotal = CaloE + CaloH;
-
-        return CaloTotal * (1.0 - emfrac);
-      }
-      return 0.0;
-    } else {
-      return 0.0;
-    }
-  }
-
-  Double_t jetTagging(TString varName, TObject *obj, std::map<std::string, std::any> *DataStore) {
-    if (obj->InheritsFrom("Jet")) {
-      auto p = static_cast<Jet *>(obj);
-
-      JetTaggingTool *jet_tagger = jet_tagger->getInstance(getData());
-      jet_tagger->execute(obj, DataStore);
-
-      if (varName.Contains("jet_charge_05")) {
-        return jet_tagger->getJetTaggingInfo(obj).jet_charge_05;
-      }
-
-      if (varName.Contains("sIP3DTagger")) {
-        return jet_tagger->getJetTaggingInfo(obj).sIP3DTagged;
-      }
-
-      if (varName.Contains("kTagger")) {
-        return jet_tagger->getJetTaggingInfo(obj).kTagged;
-      }
-
-      if (varName.Contains("CharmIPXDTagger")) {
-        return jet_tagger->getJetTaggingInfo(obj).CharmIPXDTagger;
-      }
-
-      if (varName.Contains("t1_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_pt;
-      }
-
-      if (varName.Contains("t1_d0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_d0;
-      }
-
-      if (varName.Contains("t1_d0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_d0err;
-      }
-
-      if (varName.Contains("t1_z0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_z0;
-      }
-
-      if (varName.Contains("t1_z0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_z0err;
-      }
-
-      if (varName.Contains("t1_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_sIP3D;
-      }
-
-      if (varName.Contains("t1_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_IP3D;
-      }
-
-      if (varName.Contains("t1_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t1_IP2D;
-      }
-
-      if (varName.Contains("t2_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_pt;
-      }
-
-      if (varName.Contains("t2_d0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_d0;
-      }
-
-      if (varName.Contains("t2_d0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_d0err;
-      }
-
-      if (varName.Contains("t2_z0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_z0;
-      }
-
-      if (varName.Contains("t2_z0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_z0err;
-      }
-
-      if (varName.Contains("t2_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_sIP3D;
-      }
-
-      if (varName.Contains("t2_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_IP3D;
-      }
-
-      if (varName.Contains("t2_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t2_IP2D;
-      }
-
-      if (varName.Contains("t3_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_pt;
-      }
-
-      if (varName.Contains("t3_d0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_d0;
-      }
-
-      if (varName.Contains("t3_d0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_d0err;
-      }
-
-      if (varName.Contains("t3_z0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_z0;
-      }
-
-      if (varName.Contains("t3_z0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_z0err;
-      }
-
-      if (varName.Contains("t3_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_sIP3D;
-      }
-
-      if (varName.Contains("t3_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_IP3D;
-      }
-
-      if (varName.Contains("t3_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t3_IP2D;
-      }
-
-      if (varName.Contains("t4_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_pt;
-      }
-
-      if (varName.Contains("t4_d0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_d0;
-      }
-
-      if (varName.Contains("t4_d0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_d0err;
-      }
-
-      if (varName.Contains("t4_z0")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_z0;
-      }
-
-      if (varName.Contains("t4_z0err")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_z0err;
-      }
-
-      if (varName.Contains("t4_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_sIP3D;
-      }
-
-      if (varName.Contains("t4_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_IP3D;
-      }
-
-      if (varName.Contains("t4_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).t4_IP2D;
-      }
-
-      if (varName.Contains("k1_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).k1_pt;
-      }
-
-      if (varName.Contains("k1_q")) {
-        return jet_tagger->getJetTaggingInfo(obj).k1_q;
-      }
-
-      if (varName.Contains("k1_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).k1_IP2D;
-      }
-
-      if (varName.Contains("k1_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).k1_IP3D;
-      }
-
-      if (varName.Contains("k1_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).k1_sIP3D;
-      }
-
-      if (varName.Contains("k2_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).k2_pt;
-      }
-
-      if (varName.Contains("k2_q")) {
-        return jet_tagger->getJetTaggingInfo(obj).k2_q;
-      }
-
-      if (varName.Contains("k2_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).k2_IP2D;
-      }
-
-      if (varName.Contains("k2_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).k2_IP3D;
-      }
-
-      if (varName.Contains("k2_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).k2_sIP3D;
-      }
-
-      if (varName.Contains("e1_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).e1_pt;
-      }
-
-      if (varName.Contains("e1_q")) {
-        return jet_tagger->getJetTaggingInfo(obj).e1_q;
-      }
-
-      if (varName.Contains("e1_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).e1_IP2D;
-      }
-
-      if (varName.Contains("e1_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).e1_IP3D;
-      }
-
-      if (varName.Contains("e1_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).e1_sIP3D;
-      }
-
-      if (varName.Contains("e2_PT")) {
-        return jet_tagger->getJetTaggingInfo(obj).e2_pt;
+        if (variable == "PT") {
+          return [this](TObject *obj, DataStore *store) {
+                   auto truthparticle = static_cast<GenParticle *>(_particle_match->best(obj));
+                   return (truthparticle != nullptr) ? Double_t(truthparticle->PT) : -999.0;
+                 };
+        }
+        return truthReference<Track>(variable);
+      } else if (type == "Electron") {
+        if (variable == "ID") {
+          return [](TObject *obj, DataStore *) {
+                   GenParticle *original = truthParticle<Electron>(obj);
+                   return (original != nullptr) ? Double_t(original->PID) : 0.0;
+                 };
+        }
+        return truthReference<Electron>(variable);
+      } else if (type == "Muon") {
+        if (variable == "ID") {
+          return [](TObject *obj, DataStore *) {
+                   return -13.0 * static_cast<Muon *>(obj)->Charge;
+                 };
+        }
+        return truthReference<Muon>(variable);
       }
+    } else if (group == "CALO") {
+      if (type == "Electron") {
+        Bool_t em = (variable == "Eem");
 
-      if (varName.Contains("e2_q")) {
-        return jet_tagger->getJetTaggingInfo(obj).e2_q;
-      }
+        if (!em && (variable != "Ehad")) return constant(0.0);
 
-      if (varName.Contains("e2_IP2D")) {
-        return jet_tagger->getJetTaggingInfo(obj).e2_IP2D;
+        return [this, em](TObject *obj, DataStore *store) {
+                 return electronCalo(static_cast<Electron *>(obj), store, em);
+               };
       }
+    } else if (group == "TAG") {
+      Double_t JetTaggingInfo::*field = taggingField(variable);
 
-      if (varName.Contains("e2_IP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).e2_IP3D;
-      }
+      if ((type == "Jet") && (field != nullptr)) {
+        JetTaggingTool *jet_tagger = JetTaggingTool::getInstance(getData());
 
-      if (varName.Contains("e2_sIP3D")) {
-        return jet_tagger->getJetTaggingInfo(obj).e2_sIP3D;
+        return [jet_tagger, field](TObject *obj, DataStore *store) {
+                 return jet_tagger->getJetTaggingInfo(obj, store).*field;
+               };
       }
     }
-    return 0.0;
+    return constant(0.0);
   }
 };
 
@@ -11,6 +11,16 @@ set ExecutionPath {
     TreeWriter
 }
 
+#######################################
+# Output file policy (all optional)
+#######################################
+
+# set OutputCompressionAlgorithm ZSTD
+# set OutputCompressionLevel 5
+# set OutputBasketSize 64000
+# set OutputClusterSize -30000000
+# set OutputImplicitMT true
+
 module ElectronRefinerModule TaggingElectron {
     set inputList Electron
     set outputList TaggingElectron
@@ -51,6 +61,8 @@ module TreeWriterModule TreeWriter {
     add branches {Track} {dualRICHcfTrack} {Kinematics PID Truth}
     add branches {Electron} {ChargedElectron} {Kinematics Calorimeter Truth}
     add branches {Jet} {FiducialJet} {Kinematics Truth JetTagging}
+    # Storage type overrides (double, float, int32, int16, bool)
+    # add types {Jet} {FiducialJet} {KIN_PT double KIN_Eta double}
 }
 
 
@@ -16,8 +16,15 @@
 # it will ask you to specify them. For instance, to run the first variation in a
 # study,
 #
-# SLURM_ARRAY_TASK_ID=0 ./oleaa-slurm.py --input <DIRECTORY CONTAINING FILES> --name <OUTPUT DIRECTORY>
+# SLURM_ARRAY_TASK_ID=0 ./oleaa-slurm.py --input <DIRECTORY CONTAINING FILES> --name <OUTPUT DIRECTORY> --shards 10
 #
+# The events of all input files are split into as many shards of equal event
+# count as there are tasks in the array (or --shards), and each task processes
+# one shard. The number of events in each input file is kept in a shared index
+# in the study directory. When it is out of date, task 0 rebuilds it before
+# processing its shard and holds a lock file meanwhile; the other tasks wait
+# while the lock exists, so the files are opened once rather than by every
+# task at the same time.
 #
 
 import subprocess
@@ -28,6 +35,7 @@ import shutil
 import glob
 import re
 import ast
+import time
 
 import argparse
 
@@ -49,6 +57,13 @@ parser.add_argument("-c", "--config", type=str,
                     help="configuration file (TCL)")
 parser.add_argument("-f", "--force", default=False, action='store_true',
                     help="force-overwrite existing output")
+parser.add_argument("-r", "--resume", default=False, action='store_true',
+                    help="continue tasks from the last checkpoint of their existing output")
+parser.add_argument("--checkpoint", type=float, default=15.0,
+                    help="minutes between checkpoints of the output (0 to disable)")
+parser.add_argument("-s", "--shards", type=int,
+                    help="number of shards (default: SLURM_ARRAY_TASK_COUNT)",
+                    default=int(os.environ.get("SLURM_ARRAY_TASK_COUNT", "0")))
 
 global args
 args = parser.parse_args()
@@ -73,6 +88,15 @@ except:
 
 print("Task ID requested: %d" % (int(SLURM_ARRAY_TASK_ID)))
 
+if args.shards < 1:
+    print("Please set the number of shards with --shards (or run as a SLURM array job).")
+    sys.exit()
+
+if int(SLURM_ARRAY_TASK_ID) >= args.shards:
+    print("Task ID %d is beyond the last shard (%d shards)" %
+          (int(SLURM_ARRAY_TASK_ID), args.shards))
+    sys.exit()
+
 
 
 # Load all the ROOT files to Process
@@ -90,32 +114,46 @@ else:
 #print(root_files)
 
 
-# Use the task ID to load the necessary file from the array
+# Use the task ID as the shard number; every task sees the same input files
+# (OLeAA sorts them) and takes its share of their events
 fileNumber = int(SLURM_ARRAY_TASK_ID)
+shard = f"{fileNumber}/{args.shards}"
 
-# Search out the file number in this list
-root_file = None
-for test_file in root_files:
-    if test_file.find('%d/out.root' % fileNumber) != -1:
-        root_file = test_file
-        break
+input_pattern = os.path.abspath(args.input) + "/*/*.root"
+index_file = os.path.abspath(f"{args.output}/{args.name}/.oleaa_index")
+index_lock = index_file + ".lock"
+job_id = os.environ.get("SLURM_ARRAY_JOB_ID", "")
+print(f'Processing shard {shard} of {input_pattern}')
 
-if root_file == None:
-    print("Unable to find an input file consistent with the task ID = %d" %
-          (int(SLURM_ARRAY_TASK_ID)))
-    sys.exit()
 
-# Get the full path to the input file
-root_file = os.path.abspath(root_file)
-print(f'Processing {root_file}')
+# Whether task 0 of this array job is writing the input index. A lock left
+# by an earlier job, or by a task 0 that is no longer running, is ignored.
+def index_locked():
+    try:
+        with open(index_lock) as lock:
+            if lock.read().strip() != job_id:
+                return False
+    except OSError:
+        return False
+
+    if job_id == "":
+        return False
+
+    try:
+        queued = subprocess.run(["squeue", "-h", "-j", f"{job_id}_0"], capture_output=True, text=True)
+    except OSError:
+        return False
+    return queued.returncode == 0 and queued.stdout.strip() != ""
 
 
 # Execute the study
 
 taskdir=f"{args.output}/{args.name}/{fileNumber}"
 
-if os.path.exists(taskdir) and not args.force:
-    print("Skipping this task directory --- it already exists. Cleanup before overwriting!")
+resuming = args.resume and os.path.exists(taskdir)
+
+if os.path.exists(taskdir) and not args.force and not resuming:
+    print("Skipping this task directory --- it already exists. Cleanup before overwriting, or use --resume!")
     print(taskdir)
 else:
     if not os.path.exists(taskdir):
@@ -124,5 +162,39 @@ else:
     # Copy or Link needed files to working directory
     subprocess.call(f"cp -a share {taskdir}/", shell=True);
     subprocess.call(f"cp -a {args.config} {taskdir}/", shell=True);
-    # Execute the study
-    subprocess.call(f'cd {taskdir}; OLeAA.exe --input_dir {root_file} --output_file out.root --config_file "{args.config}"', shell=True)
+
+    # Checkpoint periodically, so that a task stopped by the time limit or
+    # preempted can be continued with --resume
+    options = f"--checkpoint_minutes {args.checkpoint}" if args.checkpoint > 0 else ""
+    if resuming:
+        options += " --resume"
+
+    command = f'cd {taskdir}; OLeAA.exe --input_dir "{input_pattern}" --shard {shard} --index_file "{index_file}" {options} --output_file out.root --config_file "{args.config}"'
+
+    # Task 0 writes the entry index of the input files when it starts, and
+    # holds the lock until the index is written (or OLeAA stops). The others
+    # wait while the lock of this job exists, instead of all opening every
+    # file at once on the shared filesystem. A task that finds no lock starts
+    # right away; concurrent index writes are atomic renames.
+    newest_input = max(os.path.getmtime(f) for f in root_files)
+    index_stale = not (os.path.exists(index_file) and os.path.getmtime(index_file) >= newest_input)
+
+    if fileNumber == 0 and index_stale:
+        with open(index_lock, "w") as lock:
+            lock.write(job_id)
+
+        oleaa = subprocess.Popen(command, shell=True)
+        try:
+            while oleaa.poll() is None and not (os.path.exists(index_file) and
+                                                os.path.getmtime(index_file) >= os.path.getmtime(index_lock)):
+                time.sleep(10)
+        finally:
+            if os.path.exists(index_lock):
+                os.remove(index_lock)
+        oleaa.wait()
+    else:
+        while fileNumber != 0 and index_locked():
+            time.sleep(10)
+
+        # Execute the study
+        subprocess.call(command, shell=True)